@@ -16,7 +16,6 @@
 #include "lluitk/list.hh"
 
 #include "llsg/llsg.hh"
-#include "llsg/transition.hh"
 
 
 struct Model {
@@ -92,10 +91,13 @@ int main() {
     
     auto app = lluitk::App();
     
-    lluitk::os::event().callback([&app]( const ::lluitk::event::Event& e) {
+    lluitk::os::event().callback([&app]( const ::lluitk::event::EventRecord& e) {
         app.processEvent(e);
     });
     
+    // merge mouse moves and wheel deltas between frames
+    lluitk::os::event().coalesce(true);
+    
     // grid widget
     lluitk::Grid     grid({1,1});
     
@@ -132,63 +134,12 @@ int main() {
     
     
     
-    // schedule transition
-    
+    app.clearColor(1.0f,1.0f,1.0f);
     
-    bool update_cursor = true;
-    int  parity        = 0;
+    // blink the cursor of the key focus widget
+    app.cursorBlink(500000);
     
-    while (!window.done()) {
-        
-        /* Render here */
-        glClearColor(1.0f,1.0f,1.0f,1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        
-        glViewport(0,0,window.framebuffer_width,window.framebuffer_height);
-        
-        // glShadeModel(GL_SMOOTH);
-        // glEnable(GL_MULTISAMPLE);
-        // glEnable( GL_POLYGON_SMOOTH );
-        // glHint(GL_LINE_SMOOTH_HINT,GL_NICEST);
-        // glHint(GL_POLYGON_SMOOTH_HINT,GL_NICEST);
-        
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(0, window.framebuffer_width,
-                0, window.framebuffer_height,
-                0, 1);
-        
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-        
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        
-        app.main_widget->render();
-        
-        window.swap_buffers();
-        
-        lluitk::os::event().poll(); // poll events
-        
-        transition::getTransitionEngine().update();
-        
-        if (update_cursor) {
-            transition::getTransitionEngine()
-            .addTransitionToStandByList(transition::Transition([&](double t) {
-                if (t == 1.0) {
-                    parity = 1 - parity;
-                    if (app._key_focus_widget) {
-                        app._key_focus_widget->blink(parity);
-                    }
-                    update_cursor = true;
-                }
-            }).duration(transition::Duration{500})).startStandByTransitions();
-            update_cursor = false;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        
-    }
+    app.run(window);
     
     return 0;
 }
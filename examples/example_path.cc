@@ -167,14 +167,14 @@ int main() {
     // set coef for retina display
     // llsg::opengl::getRenderer()._resolution_factor = window.window_to_framebuffer_factor;
     
-    lluitk::os::event().callback([&app,&panel]( const ::lluitk::event::Event& e) {
-//        if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.asKeyPress().key == lluitk::event::KEY_S) {
+    lluitk::os::event().callback([&app,&panel]( const ::lluitk::event::EventRecord& e) {
+//        if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.key() == lluitk::event::KEY_S) {
 //            auto n = grid.code(&buffer[0], 5000);
 //            std::cout << buffer << std::endl;
 //            std::cout << "Saved grid layout size if " << n << std::endl;
 //            saved = true;
 //        }
-//        else if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.asKeyPress().key == lluitk::event::KEY_L) {
+//        else if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.key() == lluitk::event::KEY_L) {
 //            if (saved) {
 //                lluitk::grid2::Grid2 local_grid;
 //                auto error = lluitk::grid2::parse(buffer, local_grid);
@@ -228,7 +228,7 @@ int main() {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         
-        app.main_widget->render();
+        app.renderTree();
         
         window.swap_buffers();
         
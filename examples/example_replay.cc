@@ -0,0 +1,135 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "lluitk/app.hh"
+#include "lluitk/event_log.hh"
+#include "lluitk/grid2.hh"
+#include "lluitk/os.hh"
+#include "lluitk/replay.hh"
+#include "lluitk/textedit.hh"
+#include "lluitk/tree_stats.hh"
+
+//
+// replays a recorded session (text or binary event log) against the widget
+// tree of example_textedit in an invisible window and prints the report:
+//
+//     example_replay session.log [--realtime] [--no-render] [--tree-stats json|csv|types] [--round-trip]
+//
+// --tree-stats also writes the memory and structure of the widget tree
+// after the replay (see TreeStats)
+//
+// --round-trip first checks that the log converts between the text and
+// binary formats without losing or changing events (exits with 2 if not)
+//
+
+// text -> binary -> text; false if the two conversions count differently
+static bool canonicalText(const std::string &text, std::string &result, std::size_t &count) {
+    std::istringstream is(text);
+    std::ostringstream binary;
+    count = lluitk::event::textToBinary(is, binary);
+    auto b = binary.str();
+    std::ostringstream os;
+    auto ok = lluitk::event::binaryToText(b.data(), b.size(), os) == count;
+    result = os.str();
+    return ok;
+}
+
+static bool roundTrip(const lluitk::event::MappedFile &file, bool binary) {
+    std::string text;
+    std::size_t count = 0;
+    if (binary) {
+        std::ostringstream os;
+        count = lluitk::event::binaryToText(file.data(), file.size(), os);
+        text  = os.str();
+    }
+    else {
+        text.assign((const char*) file.data(), file.size());
+    }
+    std::string once, twice;
+    std::size_t n1 = 0, n2 = 0;
+    auto ok = canonicalText(text, once, n1) && canonicalText(once, twice, n2) &&
+              n1 == n2 && once == twice && (!binary || (n1 == count && once == text));
+    std::cerr << "round trip: " << n1 << " events " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+LLUITK_COUNT_ALLOCATIONS
+
+int main(int argc, char** argv) {
+    
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <event-log> [--realtime] [--no-render] [--tree-stats json|csv|types] [--round-trip]" << std::endl;
+        return 1;
+    }
+    
+    bool realtime = false;
+    bool render   = true;
+    bool check    = false;
+    std::string tree_stats;
+    for (auto i=2;i<argc;++i) {
+        if (std::strcmp(argv[i], "--realtime") == 0)
+            realtime = true;
+        else if (std::strcmp(argv[i], "--no-render") == 0)
+            render = false;
+        else if (std::strcmp(argv[i], "--round-trip") == 0)
+            check = true;
+        else if (std::strcmp(argv[i], "--tree-stats") == 0 && i+1 < argc)
+            tree_stats = argv[++i];
+    }
+    
+    auto &window = lluitk::os::graphics().window(800, 600, false);
+    window.bind_to_thread();
+    
+    auto app = lluitk::App();
+    
+    const std::vector<llsg::Color> colors = {"#a6cee3","#1f78b4","#b2df8a"};
+    
+    const int n = 3;
+    lluitk::TextEdit textedits[n];
+    for (auto i=0;i<n;++i) textedits[i].style().bgcolor().reset(colors[i]);
+    
+    lluitk::grid2::Grid2 grid;
+    grid.border_size(20);
+    grid.margin_size(5);
+    for (auto i=0;i<n;++i) { grid.insert(&textedits[i], i); }
+    
+    app.setMainWidget(&grid);
+    app.window(window);
+    app.processEvent(lluitk::event::EventRecord::windowResize({ (double) window.framebuffer_width, (double) window.framebuffer_height }));
+    
+    lluitk::Replay replay(app);
+    replay.realtime(realtime).render(render);
+    
+    lluitk::event::MappedFile file(argv[1]);
+    
+    auto binary = file.size() >= sizeof(lluitk::event::BINARY_LOG_MAGIC) &&
+        std::memcmp(file.data(), lluitk::event::BINARY_LOG_MAGIC, sizeof(lluitk::event::BINARY_LOG_MAGIC)) == 0;
+    
+    if (check && !roundTrip(file, binary))
+        return 2;
+    
+    lluitk::ReplayReport report;
+    if (binary) {
+        lluitk::event::BinaryLogReader reader(file.data(), file.size());
+        report = replay.run(reader);
+    }
+    else {
+        std::ifstream is(argv[1]);
+        report = replay.run(is);
+    }
+    
+    report.print(std::cout);
+    
+    if (!tree_stats.empty()) {
+        lluitk::TreeStats stats(&grid);
+        if (tree_stats == "json")
+            stats.json(std::cout);
+        else
+            stats.csv(std::cout, tree_stats == "types");
+    }
+    
+    return 0;
+}
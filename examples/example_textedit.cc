@@ -10,7 +10,6 @@
 #include "lluitk/grid2.hh"
 #include "lluitk/os.hh"
 
-#include "llsg/transition.hh"
 
 int main() {
 
@@ -58,14 +57,14 @@ int main() {
     
     bool saved = false;
     char buffer[5000];
-    lluitk::os::event().callback([&app,&buffer,&grid,&saved,&textedits]( const ::lluitk::event::Event& e) {
-        if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.asKeyPress().key == lluitk::event::KEY_S) {
+    lluitk::os::event().callback([&app,&buffer,&grid,&saved,&textedits]( const ::lluitk::event::EventRecord& e) {
+        if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.key() == lluitk::event::KEY_S) {
             auto n = grid.code(&buffer[0], 5000);
             std::cout << buffer << std::endl;
             std::cout << "Saved grid layout size if " << n << std::endl;
             saved = true;
         }
-        else if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.asKeyPress().key == lluitk::event::KEY_L) {
+        else if (e.getType() == lluitk::event::EVENT_KEY_PRESS && e.key() == lluitk::event::KEY_L) {
             if (saved) {
                 lluitk::grid2::Grid2 local_grid;
                 auto error = lluitk::grid2::parse(buffer, local_grid);
@@ -90,60 +89,16 @@ int main() {
         }
     });
     
+    // merge mouse moves and wheel deltas between frames
+    lluitk::os::event().coalesce(true);
+    
     
     // app.
     
-    // schedule transition
-
+    // blink the cursor of the key focus widget
+    app.cursorBlink(500000);
     
-    bool update_cursor = true;
-    int  parity        = 0;
-    
-    while (!window.done()) {
-        
-        /* Render here */
-        glClearColor(0.0f,0.0f,0.0f,1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        
-        glViewport(0,0,window.framebuffer_width,window.framebuffer_height);
-        
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(0, window.framebuffer_width,
-                0, window.framebuffer_height,
-                0, 1);
-        
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        app.main_widget->render();
-        
-        window.swap_buffers();
-        
-        lluitk::os::event().poll(); // poll events
-        
-        transition::getTransitionEngine().update();
-
-        if (update_cursor) {
-            transition::getTransitionEngine()
-            .addTransitionToStandByList(transition::Transition([&](double t) {
-                if (t == 1.0) {
-                    parity = 1 - parity;
-                    if (app._key_focus_widget) {
-                        app._key_focus_widget->blink(parity);
-                    }
-                    update_cursor = true;
-                }
-            }).duration(transition::Duration{500})).startStandByTransitions();
-            update_cursor = false;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    app.run(window);
     
-    }
-
     return 0;
 }
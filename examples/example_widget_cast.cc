@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "lluitk/grid.hh"
+#include "lluitk/grid2.hh"
+#include "lluitk/textedit.hh"
+
+//
+// compares Widget::as<T>() (kind bit test) with the dynamic_cast it
+// replaces, and the WIDGET_KEY_EVENTS bit with the acceptsKeyEvents()
+// virtual call, over a mix of widget types:
+//
+//     example_widget_cast [iterations]
+//
+
+struct PlainWidget: public lluitk::Widget {};
+
+// a subclass without its own kind: as<Custom>() falls back to dynamic_cast
+struct Custom: public lluitk::TextEdit {};
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+static void bench(const char *name, const std::vector<lluitk::Widget*> &widgets, int iterations, F f) {
+    std::size_t hits = 0;
+    auto t0 = Clock::now();
+    for (auto i=0;i<iterations;++i) {
+        for (auto w: widgets) {
+            hits += f(w) ? 1 : 0;
+        }
+    }
+    auto ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    std::cout << std::left << std::setw(36) << name
+              << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+              << ns / ((double) iterations * widgets.size()) << " ns/op"
+              << "   (" << hits << " hits)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    
+    auto iterations = argc > 1 ? std::atoi(argv[1]) : 20000;
+    
+    const int n = 256;
+    std::vector<lluitk::TextEdit>     textedits(n);
+    std::vector<Custom>               customs(n);
+    std::vector<lluitk::grid2::Grid2> grids(n);
+    std::vector<PlainWidget>          plains(n);
+    
+    std::vector<lluitk::Widget*> widgets;
+    for (auto i=0;i<n;++i) {
+        widgets.push_back(&textedits[i]);
+        widgets.push_back(&grids[i]);
+        widgets.push_back(&plains[i]);
+        widgets.push_back(&customs[i]);
+    }
+    
+    using lluitk::Widget;
+    using lluitk::SimpleWidget;
+    using lluitk::TextEdit;
+    
+    bench("dynamic_cast<SimpleWidget*>", widgets, iterations, [](Widget *w) { return dynamic_cast<SimpleWidget*>(w) != nullptr; });
+    bench("as<SimpleWidget>()",          widgets, iterations, [](Widget *w) { return w->as<SimpleWidget>() != nullptr; });
+    bench("dynamic_cast<TextEdit*>",     widgets, iterations, [](Widget *w) { return dynamic_cast<TextEdit*>(w) != nullptr; });
+    bench("as<TextEdit>()",              widgets, iterations, [](Widget *w) { return w->as<TextEdit>() != nullptr; });
+    bench("as<Custom>() (no kind)",      widgets, iterations, [](Widget *w) { return w->as<Custom>() != nullptr; });
+    bench("acceptsKeyEvents()",          widgets, iterations, [](Widget *w) { return w->acceptsKeyEvents(); });
+    bench("is(WIDGET_KEY_EVENTS)",       widgets, iterations, [](Widget *w) { return w->is(lluitk::WIDGET_KEY_EVENTS); });
+    
+    return 0;
+}
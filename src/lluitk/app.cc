@@ -1,13 +1,32 @@
 #include "app.hh"
 
 #include "widget.hh"
+#include "os.hh"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+
+#include <GL/glew.h>
 
 namespace lluitk {
 
     static Microseconds now() {
-        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        return clock().now();
+    }
+    
+    //------------------------------------------------------------------------------
+    // HoverEntry
+    //------------------------------------------------------------------------------
+    
+    HoverEntry::HoverEntry(Widget *widget):
+    widget(widget)
+    {
+        has_bounds = widget->bounds(bounds);
+    }
+    
+    bool HoverEntry::contains(const Point& p) const {
+        return has_bounds ? bounds.contains(p) : widget->contains(p);
     }
     
     //------------------------------------------------------------------------------
@@ -16,22 +35,418 @@ namespace lluitk {
     
     App::App() {
         _start_time = now();
+        _unpresented_inputs.reserve(MAX_UNPRESENTED_INPUTS);
     }
 
     
     void App::setMainWidget(Widget *w) {
         main_widget = w;
+        
+        _damage->root(w);
+        
+        if (_hit_index)
+            _hit_index->reset(w);
+        
+        _hover_path.clear();
+        _hover_valid = false;
+        
+        _culler->reset();
+        requestRender();
 
-        WidgetTreeIterator iter(*w);
-        Widget* ww;
-        while ( (ww = iter.next() ) ) {
-            if (ww->acceptsKeyEvents()) {
-                setKeyFocus(ww);
+        Widget *focus = nullptr;
+        _walker.walk(w, [&focus](Widget *ww) {
+            if (!ww->acceptsKeyEvents())
+                return WALK_CONTINUE;
+            focus = ww;
+            return WALK_STOP;
+        });
+        if (focus)
+            setKeyFocus(focus);
+    }
+
+    void App::enableHitIndex(bool flag) {
+        if (!flag) {
+            _hit_index.reset();
+        }
+        else if (!_hit_index) {
+            _hit_index.reset(new HitIndex());
+            _hit_index->reset(main_widget);
+        }
+    }
+
+    App& App::clearColor(float r, float g, float b, float a) {
+        _clear_color[0] = r;
+        _clear_color[1] = g;
+        _clear_color[2] = b;
+        _clear_color[3] = a;
+        requestRender();
+        return *this;
+    }
+    
+    bool App::layout() {
+        if (!main_widget || !_has_layout_window)
+            return false;
+        auto t0 = now();
+        auto previous_pool      = layoutPool();
+        auto previous_threshold = layoutCostThreshold();
+        layoutPool(_layout_pool.get());
+        layoutCostThreshold(_layout_min_subtree);
+        auto arranged = main_widget->arrange(_layout_window);
+        layoutPool(previous_pool);
+        layoutCostThreshold(previous_threshold);
+        if (!arranged)
+            return false;
+        notifyLayoutChanged(main_widget);
+        _flight->layout(main_widget, now() - t0);
+        return true;
+    }
+    
+    App& App::parallelLayout(std::size_t threads, std::size_t min_subtree) {
+        _layout_pool.reset(threads ? new LayoutPool(threads) : nullptr);
+        _layout_min_subtree = min_subtree;
+        return *this;
+    }
+    
+    bool App::needsRender() const {
+        if (_render_requested || !_damage->pending().empty())
+            return true;
+        if (main_widget && _has_layout_window && !main_widget->layoutValid())
+            return true;
+        if (!main_widget)
+            return false;
+        auto &culler = *_culler;
+        return !_walker.walk(main_widget, [&culler](Widget *w) {
+            auto cull = culler.test(w);
+            if (cull == CULL_SUBTREE)
+                return WALK_SKIP;
+            return (cull == CULL_NONE && w->needsRender()) ? WALK_STOP : WALK_CONTINUE;
+        });
+    }
+    
+    void App::renderTree() {
+        skipFrame(); // no swap here to measure the inputs against
+        _render_batch->stats().reset();
+        _culler->reset(); // no viewport here
+        preRenderPass();
+        renderPass(nullptr);
+    }
+    
+    void App::preRenderPass() {
+        if (!main_widget)
+            return;
+        
+        auto &culler = *_culler;
+        _walker.walk(main_widget, [&culler](Widget *w) {
+            auto cull = culler.test(w);
+            if (cull == CULL_SUBTREE)
+                return WALK_SKIP;
+            if (cull == CULL_NONE) {
+                LLUITK_PROFILE_SCOPE(w, PROFILE_PRE_RENDER);
+                w->pre_render();
+            }
+            return w->rendersChildren() ? WALK_SKIP : WALK_CONTINUE;
+        });
+    }
+    
+    void App::renderPass(const Window *clip) {
+        if (!main_widget)
+            return;
+        
+        // widgets submit through the batch (display lists, stats)
+        auto previous = renderBatch();
+        renderBatch(_render_batch.get());
+        _render_batch->context(os::currentContext());
+        
+        auto &culler = *_culler;
+        _walker.walk(main_widget,
+                     [clip, &culler](Widget *w) {
+                         auto cull = culler.test(w);
+                         if (cull == CULL_SUBTREE)
+                             return WALK_SKIP;
+                         Window bounds;
+                         if (clip && w->bounds(bounds) && !intersects(bounds, *clip))
+                             return WALK_SKIP;
+                         if (cull == CULL_NONE) {
+                             LLUITK_PROFILE_SCOPE(w, PROFILE_RENDER);
+                             w->render();
+                         }
+                         return w->rendersChildren() ? WALK_SKIP : WALK_CONTINUE;
+                     },
+                     [](Widget *w) {
+                         LLUITK_PROFILE_SCOPE(w, PROFILE_RENDER);
+                         w->render_overlay();
+                     });
+        
+        _render_batch->flush();
+        renderBatch(previous);
+    }
+    
+    //
+    // damage to draw in this frame: what was invalidated since the last
+    // frame, the bounds of the widgets that need to render and whatever the
+    // older frames still present in the back buffer missed
+    //
+    DamageRegion App::frameDamage(const os::Window &window) {
+        DamageRegion current = _damage->pending();
+        _damage->pending().clear();
+        
+        if (_render_requested || !_partial_redraw || _buffer_age < 1 ||
+            _damage_layout_version != layoutVersion(main_widget) ||
+            _damage_framebuffer[0] != window.framebuffer_width ||
+            _damage_framebuffer[1] != window.framebuffer_height) {
+            current.addAll();
+        }
+        _damage_layout_version = layoutVersion(main_widget);
+        _damage_framebuffer[0] = window.framebuffer_width;
+        _damage_framebuffer[1] = window.framebuffer_height;
+        
+        if (!current.full() && main_widget) {
+            auto &culler = *_culler;
+            _walker.walk(main_widget, [&current, &culler](Widget *w) {
+                auto cull = culler.test(w);
+                if (cull == CULL_SUBTREE)
+                    return WALK_SKIP;
+                if (cull == CULL_SELF || !w->needsRender())
+                    return WALK_CONTINUE;
+                Window bounds;
+                if (!w->bounds(bounds)) {
+                    current.addAll();
+                    return WALK_STOP;
+                }
+                current.add(bounds);
+                return WALK_CONTINUE;
+            });
+        }
+        
+        auto result = current;
+        for (auto &older: _damage_history) {
+            result.add(older);
+        }
+        
+        auto keep = (std::size_t) std::max(_buffer_age - 1, 0);
+        if (_damage_history.size() < keep)
+            _damage_history.push_back(current);
+        if (!_damage_history.empty()) {
+            std::rotate(_damage_history.rbegin(), _damage_history.rbegin() + 1, _damage_history.rend());
+            _damage_history.front() = current;
+        }
+        
+        return result;
+    }
+    
+    void App::renderFrame(os::Window &window) {
+        auto t0 = now();
+        _flight->frameBegin();
+        _render_batch->stats().reset();
+        
+        window.make_current();
+        
+        layout(); // pending invalidateLayout()
+        
+        if (_culling && main_widget)
+            _culler->update(main_widget, Window(Vec2(0, 0), Vec2(window.framebuffer_width, window.framebuffer_height)));
+        else
+            _culler->reset();
+        
+        auto damage = frameDamage(window);
+        _render_requested = false;
+        
+        glViewport(0,0,window.framebuffer_width,window.framebuffer_height);
+        
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrtho(0, window.framebuffer_width,
+                0, window.framebuffer_height,
+                0, 1);
+        
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        
+        glClearColor(_clear_color[0],_clear_color[1],_clear_color[2],_clear_color[3]);
+        
+        {
+            LLUITK_PROFILE_BIND(_profiler);
+            preRenderPass();
+            if (damage.full()) {
+                glClear(GL_COLOR_BUFFER_BIT);
+                renderPass(nullptr);
+            }
+            else {
+                glEnable(GL_SCISSOR_TEST);
+                for (auto i=0;i<damage.size();++i) {
+                    // whole pixels covering the rectangle
+                    auto x0 = std::max(0, (int) std::floor(damage[i].x()));
+                    auto y0 = std::max(0, (int) std::floor(damage[i].y()));
+                    auto x1 = std::min(window.framebuffer_width,  (int) std::ceil(damage[i].X()));
+                    auto y1 = std::min(window.framebuffer_height, (int) std::ceil(damage[i].Y()));
+                    if (x1 <= x0 || y1 <= y0)
+                        continue;
+                    Window clip(Vec2(x0, y0), Vec2(x1, y1));
+                    glScissor(x0, y0, x1 - x0, y1 - y0);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    renderPass(&clip);
+                }
+                glDisable(GL_SCISSOR_TEST);
+            }
+        }
+        _last_damage = damage;
+        
+        window.swap_buffers();
+        
+        _flight->frameEnd(now() - t0);
+        
+        for (auto t: _unpresented_inputs) {
+            _present_latency.add((window.last_swap > t ? window.last_swap - t : 0) * 1000);
+        }
+        _unpresented_inputs.clear();
+    }
+    
+    void App::resetLatency() {
+        _queue_latency   = LatencyHistogram();
+        _present_latency = LatencyHistogram();
+        _unpresented_inputs.clear();
+    }
+    
+    void App::addTimer(Microseconds delay, TimerCallback callback, Microseconds period) {
+        _timers.push_back(Timer(now() + delay, period, callback));
+    }
+    
+    void App::cursorBlink(Microseconds period) {
+        addTimer(period, [this]() {
+            _blink_parity = 1 - _blink_parity;
+            if (_key_focus_widget) {
+                _key_focus_widget->blink(_blink_parity);
+            }
+        }, period);
+    }
+    
+    void App::post(PostQueue::Task task) {
+        _posted->push(std::move(task));
+        os::event().wake();
+    }
+    
+    std::size_t App::runPosted(std::size_t max) {
+        PostQueue::Task task;
+        std::size_t count = 0;
+        while (count < max && _posted->pop(task)) {
+            ++count;
+            task();
+        }
+        return count;
+    }
+    
+    void App::runTimers() {
+        auto t = now();
+        
+        // callbacks may add timers: collect the due ones first
+        _due_timers.clear();
+        auto it = _timers.begin();
+        while (it != _timers.end()) {
+            if (it->due <= t) {
+                _due_timers.push_back(*it);
+                if (it->period) {
+                    // skip missed ticks instead of firing them in a burst
+                    it->due = std::max(it->due + it->period, t + 1);
+                    ++it;
+                }
+                else {
+                    it = _timers.erase(it);
+                }
+            }
+            else {
+                ++it;
+            }
+        }
+        for (auto &timer: _due_timers) {
+            timer.callback();
+        }
+    }
+    
+    App& App::window(os::Window &window) {
+        _window = &window;
+        return *this;
+    }
+    
+    App& App::attach(os::Window &window) {
+        _window = &window;
+        os::event().callback(window, [this](const event::EventRecord& e) {
+            processEvent(e);
+        });
+        return *this;
+    }
+    
+    bool App::frame() {
+        if (!_window || !needsRender()) {
+            skipFrame(); // nothing visible came out of them
+            return false;
+        }
+        renderFrame(*_window);
+        return true;
+    }
+    
+    double App::waitTimeout() const {
+        if (_posted->size())
+            return 0.0; // batch limit left work behind: don't sleep
+        if (_timers.empty())
+            return -1.0;
+        auto t   = now();
+        auto due = std::min_element(_timers.begin(), _timers.end(), [](const Timer& a, const Timer& b) {
+            return a.due < b.due;
+        })->due;
+        return due > t ? (due - t) / 1.0e6 : 0.0;
+    }
+    
+    void App::idle() {
+        runTimers();
+        runPosted(_post_batch);
+    }
+    
+    void App::run(os::Window &window) {
+        this->window(window);
+        lluitk::run(std::vector<App*> { this });
+    }
+    
+    //------------------------------------------------------------------------------
+    // run
+    //------------------------------------------------------------------------------
+    
+    //
+    // Whatever becomes dirty is a consequence of the events and timers just
+    // processed, so rendering right after them and then blocking is enough:
+    // no frame is drawn (and no cpu is used) while the ui is idle. Each app
+    // only renders when its own tree is dirty.
+    //
+    void run(const std::vector<App*> &apps) {
+        for (auto app: apps) {
+            app->window()->bind_to_thread();
+        }
+        while (true) {
+            auto open    = false;
+            auto timeout = -1.0;
+            for (auto app: apps) {
+                if (app->window()->done())
+                    continue;
+                open = true;
+                app->frame();
+                auto t = app->waitTimeout();
+                if (t >= 0.0 && (timeout < 0.0 || t < timeout))
+                    timeout = t;
+            }
+            if (!open)
                 break;
+            
+            os::event().wait(timeout);
+            
+            for (auto app: apps) {
+                if (!app->window()->done())
+                    app->idle();
             }
         }
     }
-
+    
     void App::startEventProcessing() const {
         event_done = false;
     }
@@ -54,65 +469,177 @@ namespace lluitk {
         }
     }
     
+    //
+    // extends path (which ends in a widget containing p) with the children
+    // events at p would be routed to
+    //
+    void App::descend(std::vector<HoverEntry> &path, const Point& p) {
+        if (path.empty())
+            return;
+        
+        if (_hit_index) {
+            _hit_path.clear();
+            auto complete = _hit_index->path(p, path.back().widget, _hit_path);
+            for (auto i=1;i<(int)_hit_path.size();++i) {
+                path.push_back(HoverEntry(_hit_path[i]));
+            }
+            _hit_path.clear();
+            if (complete)
+                return;
+        }
+        
+        auto w = path.back().widget;
+        while (w) {
+            Widget *child = nullptr;
+            auto it = w->reverse_children();
+            while ((child = it.next())) {
+                if (child->contains(p)) {
+                    path.push_back(HoverEntry(child));
+                    break;
+                }
+            }
+            w = child;
+        }
+    }
+    
+    //
+    // leading entries of path that are still in the tree: the first one is
+    // root and each other one a child of the previous one
+    //
+    static std::size_t reachable(const std::vector<HoverEntry> &path, const Widget *root) {
+        if (path.empty() || path[0].widget != root)
+            return 0;
+        std::size_t n = 1;
+        for (;n<path.size();++n) {
+            auto found = false;
+            auto it = path[n-1].widget->children();
+            while (auto child = it.next()) {
+                if (child == path[n].widget) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+                break;
+        }
+        return n;
+    }
+    
+    //
+    // Keeps the longest prefix of the cached hover path whose (cached)
+    // windows still contain p and resolves the rest of the path from there.
+    // Siblings are assumed not to overlap, so a move inside the current leaf
+    // costs a few box tests. Leave/enter messages go to the widgets that
+    // left/joined the path (deepest first on leave, top-down on enter).
+    // After a layout change the entries that left the tree are dropped
+    // without a leave message: they may have been deleted.
+    //
+    void App::updateHover(const Point& p) {
+        auto version = layoutVersion(main_widget);
+        if (_hover_valid && version == _hover_layout_version && p == _hover_position)
+            return;
+        
+        if (_hover_valid && version != _hover_layout_version)
+            _hover_path.resize(reachable(_hover_path, main_widget));
+        
+        std::size_t keep = 0;
+        if (_hover_valid && version == _hover_layout_version) {
+            while (keep < _hover_path.size() && _hover_path[keep].contains(p)) {
+                ++keep;
+            }
+        }
+        
+        auto &path = _hover_scratch;
+        path.assign(_hover_path.begin(), _hover_path.begin() + keep);
+        if (path.empty() && main_widget->contains(p)) {
+            path.push_back(HoverEntry(main_widget));
+        }
+        descend(path, p);
+        
+        std::size_t common = 0;
+        while (common < path.size() && common < _hover_path.size() && path[common].widget == _hover_path[common].widget) {
+            ++common;
+        }
+        
+        std::swap(_hover_path, path);
+        _hover_position       = p;
+        _hover_layout_version = version;
+        _hover_valid          = true;
+        
+        // path now holds the previous hover path
+        for (auto i=(int)path.size()-1;i>=(int)common;--i) {
+            LLUITK_PROFILE_SCOPE(path[i].widget, PROFILE_MOUSE_LEAVE);
+            path[i].widget->onMouseLeave(*this);
+        }
+        for (auto i=common;i<_hover_path.size();++i) {
+            LLUITK_PROFILE_SCOPE(_hover_path[i].widget, PROFILE_MOUSE_ENTER);
+            _hover_path[i].widget->onMouseEnter(*this);
+        }
+    }
+    
     void App::processEvent(const event::Event& event) {
+        processEvent(event::makeRecord(event));
+    }
+    
+    void App::processEvent(const event::EventRecord& event) {
 
-        const event::Event* e = &event;
+        const event::EventRecord* e = &event;
         
         if (!main_widget)
             return;
+        
+        LLUITK_PROFILE_BIND(_profiler);
 
-        current_event_info            = last_event_info;
-        current_event_info.event_type = e->getType();
+        current_event_info                 = last_event_info;
+        current_event_info.event_type      = e->getType();
         current_event_info.timestamp(now() - _start_time);
+        current_event_info.input_timestamp = e->timestamp;
+        
+        _flight->input(event);
+        
+        if (e->timestamp) {
+            auto t = event::monotonicNow();
+            _queue_latency.add((t > e->timestamp ? t - e->timestamp : 0) * 1000);
+            if (_unpresented_inputs.size() < MAX_UNPRESENTED_INPUTS)
+                _unpresented_inputs.push_back(e->timestamp);
+        }
         
         // window resize is special
         if (e->getType() == event::EVENT_WINDOW_RESIZE) {
-            auto ee = dynamic_cast<const event::WindowResize*>(e);
-            if (main_widget)
-                main_widget->sizeHint(Window { Point {0,0}, ee->new_size } ); // main window gets the new size
+            _layout_window     = Window { Point {0,0}, e->size() }; // main window gets the new size
+            _has_layout_window = true;
+            layout();
+            requestRender();
             last_event_info = current_event_info;
             return;
         }
 
-        if (e->getType() == event::EVENT_MOUSE_MOVE) {
-            auto ee = dynamic_cast<const event::MouseMove*>(e);
-            auto p = ee->position;
-            current_event_info.mouse_position    = p;
-        }
-        else if (e->getType() == event::EVENT_MOUSE_WHEEL) {
-            auto ee = dynamic_cast<const event::MouseWheel*>(e);
-            current_event_info.modifiers         = ee->modifiers;
-            current_event_info.mouse_wheel_delta = ee->position;
-        }
-        else if (e->getType() == event::EVENT_MOUSE_PRESS) {
-            auto ee = dynamic_cast<const event::MousePress*>(e);
-            current_event_info.modifiers = ee->modifiers;
-            current_event_info.button    = ee->button;
-        }
-        else if (e->getType() == event::EVENT_MOUSE_RELEASE) {
-            auto ee = dynamic_cast<const event::MouseRelease*>(e);
-            current_event_info.modifiers = ee->modifiers;
-            current_event_info.button    = ee->button;
-        }
-        else if (e->getType() == event::EVENT_MOUSE_WHEEL) {
-            auto ee = dynamic_cast<const event::MouseWheel*>(e);
-            current_event_info.modifiers = ee->modifiers;
-            current_event_info.mouse_wheel_delta = ee->position;
-        }
-        else if (e->getType() == event::EVENT_KEY_PRESS) {
-            auto ee = dynamic_cast<const event::KeyPress*>(e);
-            current_event_info.key_code  = ee->key;
-            current_event_info.modifiers = ee->modifiers;
-        }
-        else if (e->getType() == event::EVENT_KEY_RELEASE) {
-            auto ee = dynamic_cast<const event::KeyRelease*>(e);
-            current_event_info.key_code  = ee->key;
-            current_event_info.modifiers = ee->modifiers;
+        switch (e->getType()) {
+            case event::EVENT_MOUSE_MOVE:
+                current_event_info.mouse_position    = e->position();
+                break;
+            case event::EVENT_MOUSE_WHEEL:
+                current_event_info.modifiers         = e->modifiers();
+                current_event_info.mouse_wheel_delta = e->delta();
+                break;
+            case event::EVENT_MOUSE_PRESS:
+            case event::EVENT_MOUSE_RELEASE:
+                current_event_info.modifiers = e->modifiers();
+                current_event_info.button    = e->button();
+                break;
+            case event::EVENT_KEY_PRESS:
+            case event::EVENT_KEY_RELEASE:
+                current_event_info.key_code  = e->key();
+                current_event_info.modifiers = e->modifiers();
+                break;
+            default:
+                break;
         }
 
         
         auto &app = *this;
         auto send_message = [&](Widget &active_widget, event::EventType event_type) {
+            LLUITK_PROFILE_SCOPE(&active_widget, profilePhase(event_type));
             switch(event_type) {
             case event::EVENT_MOUSE_MOVE:
             active_widget.onMouseMove(app);
@@ -140,6 +667,7 @@ namespace lluitk {
         if (e->getType() == event::EVENT_KEY_PRESS || e->getType() == event::EVENT_KEY_RELEASE) {
             if (_key_focus_widget) {
                 send_message(*_key_focus_widget, e->getType());
+                _flight->dispatch(_key_focus_widget, e->getType());
             }
         }
         else {
@@ -149,11 +677,31 @@ namespace lluitk {
             
             auto p = current_event_info.mouse_position;
             
+            updateHover(p);
+            current_event_info.mouse_over_widget = _hover_path.size() ? _hover_path.back().widget : nullptr;
+            
+            //
+            // the path is resolved up front: from the hover path or, when
+            // locked, from the hit index. If some handler changes the layout
+            // on the way down (or the index can't see below some widget) we
+            // go back to the linear scan
+            //
+            std::size_t path_index    = 0;
+            bool        path_complete = false;
+            std::size_t path_version  = layoutVersion(main_widget);
+            _hit_path.clear();
+            
             if (_locked_widget) {
                 active_widget = _locked_widget;
+                if (_hit_index)
+                    path_complete = _hit_index->path(p, active_widget, _hit_path);
             }
-            else if (main_widget->contains(p)) {
+            else if (_hover_path.size()) {
                 active_widget = main_widget;
+                for (auto &h: _hover_path) {
+                    _hit_path.push_back(h.widget);
+                }
+                path_complete = true;
             }
             
             if (active_widget) {
@@ -165,6 +713,16 @@ namespace lluitk {
                     if (event_done)
                         break;
                     
+                    if (_hit_path.size() && layoutVersion(main_widget) == path_version) {
+                        if (path_index + 1 < _hit_path.size()) {
+                            active_widget = _hit_path[++path_index];
+                            continue;
+                        }
+                        else if (path_complete) {
+                            break;
+                        }
+                    }
+                    
                     // update
                     update = false;
                     Widget *child = nullptr;
@@ -177,7 +735,9 @@ namespace lluitk {
                         }
                     }
                 }
+                _flight->dispatch(active_widget, e->getType());
             }
+            _hit_path.clear(); // no widget kept past the event: it may be deleted before the next one
 
             
             //
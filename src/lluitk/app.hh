@@ -1,20 +1,31 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "clock.hh"
+#include "culling.hh"
+#include "damage.hh"
 #include "event.hh"
+#include "flight_recorder.hh"
+#include "hit_index.hh"
+#include "layout_pool.hh"
+#include "post_queue.hh"
+#include "render_batch.hh"
+#include "profile.hh"
 
 namespace lluitk {
 
-    //------------------------------------------------------------------------------
-    // Timestamp: unix time
-    //------------------------------------------------------------------------------
-    
-    using Microseconds = std::uint64_t;
-    
     //------------------------------------------------------------------------------
     // Forward Decl.
     //------------------------------------------------------------------------------
     
     struct Widget;
+    
+    namespace os {
+        struct Window;
+    }
 
     //------------------------------------------------------------------------------
     // EventInfo
@@ -44,8 +55,43 @@ namespace lluitk {
         
         // event time is the number of microseconds elapsed since the creation of App object
         Microseconds        _timestamp { 0 };
+        
+        // monotonic time the os delivered the event (0 if it wasn't stamped)
+        event::Timestamp    input_timestamp { 0 };
     };
 
+    //------------------------------------------------------------------------------
+    // HoverEntry
+    //------------------------------------------------------------------------------
+    
+    struct HoverEntry {
+        HoverEntry() = default;
+        HoverEntry(Widget *widget);
+        
+        bool contains(const Point& p) const;
+        
+        Widget* widget { nullptr };
+        Window  bounds;
+        bool    has_bounds { false };
+    };
+    
+    //------------------------------------------------------------------------------
+    // Timer
+    //------------------------------------------------------------------------------
+    
+    using TimerCallback = std::function<void()>;
+    
+    struct Timer {
+        Timer() = default;
+        Timer(Microseconds due, Microseconds period, TimerCallback callback):
+        due(due), period(period), callback(callback)
+        {}
+        
+        Microseconds  due    { 0 }; // clock() based
+        Microseconds  period { 0 }; // zero: one-shot
+        TimerCallback callback;
+    };
+    
     //------------------------------------------------------------------------------
     // App
     //------------------------------------------------------------------------------
@@ -54,17 +100,164 @@ namespace lluitk {
         App();
 
         void setMainWidget(Widget *w);
-        void processEvent(const event::Event &event);
+        void processEvent(const event::EventRecord &event);
+        void processEvent(const event::Event &event); // adapter
         
         void startEventProcessing() const;
         void finishEventProcessing() const;
 
         void lock(Widget *w=nullptr) const; // without argument or null it unlocks
         
+        // widgets under the mouse (root to leaf) as of the last mouse event
+        const std::vector<HoverEntry>& hoverPath() const { return _hover_path; }
+        
         void setKeyFocus(Widget *w);
         
+        // route mouse events through a spatial index of the widget windows
+        // instead of scanning the children at every level (off by default)
+        void enableHitIndex(bool flag=true);
+        bool hitIndexEnabled() const { return _hit_index.get() != nullptr; }
+        
         Microseconds start_time() const { return _start_time; }
         
+        //
+        // main loop: renders a frame only when requested or when some widget
+        // needsRender(), otherwise sleeps until input, a timer or a wake()
+        // on the event layer. Returns when the window is closed. Events reach
+        // the app through the os::event() callback, as usual (or see attach).
+        // Several apps (one per window) share a loop through lluitk::run.
+        //
+        void run(os::Window &window);
+        
+        // window this app renders to
+        App& window(os::Window &window);
+        os::Window* window() const { return _window; }
+        
+        // render to window and receive its events (per-window callback of
+        // os::event()); the app must not be moved afterwards
+        App& attach(os::Window &window);
+        
+        // steps of run, for custom loops: render if needed (true if a frame
+        // was drawn), seconds until a timer or posted work is due (negative:
+        // nothing pending) and running due timers and posted work
+        bool   frame();
+        double waitTimeout() const;
+        void   idle();
+        
+        // clear, set up a pixel projection, render the tree and swap
+        void renderFrame(os::Window &window);
+        
+        // pre_render pass then render/render_overlay pass over the tree
+        // (in the current GL context)
+        void renderTree();
+        
+        bool needsRender() const;
+        void requestRender() { _render_requested = true; } // full redraw
+        
+        // arranges the main widget to the last window size if its layout
+        // was invalidated; true if anything was laid out (renderFrame calls it)
+        bool layout();
+        
+        //
+        // lays out sibling subtrees of at least min_subtree widgets on a pool
+        // of threads (0: serial layout). Only subtrees whose widgets are all
+        // WIDGET_LAYOUT_THREAD_SAFE go to the pool; the layout is complete
+        // when layout() returns and is the same as the serial one.
+        //
+        App& parallelLayout(std::size_t threads, std::size_t min_subtree=32);
+        std::size_t layoutThreads() const { return _layout_pool ? _layout_pool->size() : 0; }
+        
+        //
+        // Partial redraw: a frame only redraws the damage, i.e. the
+        // rectangles passed to Widget::invalidate plus the bounds of the
+        // widgets that needsRender(), scissored to each rectangle and
+        // visiting only the widgets that intersect it. Layout changes,
+        // resizes and requestRender() redraw everything.
+        //
+        // The back buffer is assumed to hold the frame drawn bufferAge
+        // frames ago (GLFW doesn't report it; 2 for plain double
+        // buffering), so the damage of the last bufferAge-1 frames is
+        // drawn again too. Zero disables partial redraw.
+        //
+        App& partialRedraw(bool flag) { _partial_redraw = flag; requestRender(); return *this; }
+        bool partialRedraw() const { return _partial_redraw; }
+        
+        App& bufferAge(int age) { _buffer_age = age; _damage_history.clear(); requestRender(); return *this; }
+        int  bufferAge() const { return _buffer_age; }
+        
+        // what the last frame redrew
+        const DamageRegion& lastDamage() const { return _last_damage; }
+        
+        // submissions and renderer calls of the last frame (see RenderBatch)
+        const RenderStats& renderStats() const { return _render_batch->stats(); }
+        
+        // skip widgets that can't show: outside the window, zero area
+        // (e.g. hidden Grid2 slots) or covered by an opaque() widget drawn
+        // later. Culled widgets get neither pre_render() nor render()
+        App& culling(bool flag) { _culling = flag; requestRender(); return *this; }
+        bool culling() const { return _culling; }
+        
+        // what the last frame culled
+        const CullStats& cullStats() const { return _culler->stats(); }
+        
+        // replay widgets' DisplayLists instead of rendering their unchanged
+        // groups again (see DisplayList; off: always render)
+        App& displayLists(bool flag) { _render_batch->displayLists(flag); return *this; }
+        bool displayLists() const { return _render_batch->displayLists(); }
+        
+        App& clearColor(float r, float g, float b, float a=1.0f);
+        
+        // callback runs (on the run() thread) after delay and then every
+        // period microseconds if period is not zero
+        void addTimer(Microseconds delay, TimerCallback callback, Microseconds period=0);
+        
+        // toggle the key focus widget blink parity every period microseconds
+        void cursorBlink(Microseconds period=500000);
+        
+        //
+        // runs task on the run() thread, after the pending events are
+        // dispatched and before the next frame is rendered. Safe to call from
+        // any thread: it never blocks and wakes a sleeping run().
+        //
+        void post(PostQueue::Task task);
+        
+        // runs at most max posted tasks; returns how many ran (ui thread)
+        std::size_t runPosted(std::size_t max);
+        
+        // maximum number of posted tasks run() executes between two frames
+        App& postBatch(std::size_t max) { _post_batch = max; return *this; }
+        std::size_t postBatch() const { return _post_batch; }
+        
+        //
+        // latencies (in nanoseconds) of os-stamped input events: from the os
+        // callback to dispatch (queueing delay) and to the end of the
+        // swap_buffers of the frame that showed its effect (input to
+        // present). Events that didn't lead to a frame are not counted.
+        //
+        const LatencyHistogram& queueLatency() const { return _queue_latency; }
+        const LatencyHistogram& presentLatency() const { return _present_latency; }
+        void resetLatency();
+        
+        // no frame will show the inputs dispatched so far (custom loops
+        // that skip renderFrame): they are not counted in presentLatency.
+        // frame() and renderTree() do it themselves. At most
+        // MAX_UNPRESENTED_INPUTS inputs (the oldest) wait for a frame
+        void skipFrame() { _unpresented_inputs.clear(); }
+        
+        static const std::size_t MAX_UNPRESENTED_INPUTS = 256;
+        
+        // always on record of the latest inputs, dispatch targets, frames
+        // and layouts (see FlightRecorder::dump)
+        FlightRecorder& flightRecorder() { return *_flight; }
+        const FlightRecorder& flightRecorder() const { return *_flight; }
+        
+#ifdef LLUITK_PROFILE
+        // handler and render latencies recorded while this app dispatches
+        // events and renders frames
+        const Profiler& profiler() const { return _profiler; }
+        Profiler& profiler() { return _profiler; }
+#endif
+        
     public:
         // keep a key_focus, hover, drag-n-drop model
         Widget* main_widget { nullptr };
@@ -77,6 +270,68 @@ namespace lluitk {
         EventInfo  current_event_info;
         
         Microseconds _start_time { 0 };
+        
+        std::unique_ptr<HitIndex> _hit_index;
+        std::vector<Widget*>      _hit_path;
+        
+        mutable WidgetWalker      _walker;
+        
+    private:
+        void updateHover(const Point& p);
+        void descend(std::vector<HoverEntry> &path, const Point& p);
+        
+        void runTimers();
+        
+        DamageRegion frameDamage(const os::Window &window);
+        void preRenderPass();
+        void renderPass(const Window *clip);
+        
+    private:
+        os::Window*               _window { nullptr };
+        std::vector<event::Timestamp> _unpresented_inputs;
+        LatencyHistogram          _queue_latency;
+        LatencyHistogram          _present_latency;
+        std::unique_ptr<FlightRecorder> _flight { new FlightRecorder() };
+        std::unique_ptr<PostQueue> _posted { new PostQueue() }; // keeps App movable
+        std::size_t               _post_batch { 64 };
+        std::vector<Timer>        _timers;
+        std::vector<Timer>        _due_timers;
+        float                     _clear_color[4] { 0.0f, 0.0f, 0.0f, 1.0f };
+        bool                      _render_requested { true };
+        Window                    _layout_window;
+        bool                      _has_layout_window { false };
+        std::unique_ptr<LayoutPool> _layout_pool;
+        std::size_t               _layout_min_subtree { 32 };
+        
+        std::unique_ptr<DamageTracker> _damage { new DamageTracker() };
+        std::vector<DamageRegion> _damage_history; // latest first
+        DamageRegion              _last_damage;
+        std::size_t               _damage_layout_version { 0 };
+        int                       _damage_framebuffer[2] { 0, 0 };
+        bool                      _partial_redraw { true };
+        int                       _buffer_age { 2 };
+        std::unique_ptr<RenderBatch> _render_batch { new RenderBatch() };
+        std::unique_ptr<Culler>   _culler { new Culler() };
+        bool                      _culling { true };
+        int                       _blink_parity { 0 };
+        
+#ifdef LLUITK_PROFILE
+        Profiler                  _profiler;
+#endif
+        
+        std::vector<HoverEntry>   _hover_path;
+        std::vector<HoverEntry>   _hover_scratch;
+        Point                     _hover_position;
+        std::size_t               _hover_layout_version { 0 };
+        bool                      _hover_valid { false };
     };
 
+    //------------------------------------------------------------------------------
+    // run
+    //------------------------------------------------------------------------------
+    
+    // runs apps (each with its window set) on the calling thread until all
+    // their windows are closed
+    void run(const std::vector<App*> &apps);
+    
 }
@@ -0,0 +1,125 @@
+#include "arena.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Arena
+    //------------------------------------------------------------------------------
+
+    Arena::Arena(std::size_t block_size):
+    _block_size(std::max(block_size, (std::size_t) 256))
+    {}
+
+    Arena::~Arena() {
+        clear();
+    }
+
+    Arena::Arena(Arena&& other):
+    _head(other._head),
+    _current(other._current),
+    _end(other._end),
+    _block_size(other._block_size),
+    _blocks(other._blocks),
+    _reserved(other._reserved),
+    _used(other._used)
+    {
+        other._head     = nullptr;
+        other._current  = nullptr;
+        other._end      = nullptr;
+        other._blocks   = 0;
+        other._reserved = 0;
+        other._used     = 0;
+    }
+
+    Arena& Arena::operator=(Arena&& other) {
+        if (this != &other) {
+            clear();
+            std::swap(_head,       other._head);
+            std::swap(_current,    other._current);
+            std::swap(_end,        other._end);
+            std::swap(_block_size, other._block_size);
+            std::swap(_blocks,     other._blocks);
+            std::swap(_reserved,   other._reserved);
+            std::swap(_used,       other._used);
+        }
+        return *this;
+    }
+
+    static char* align_up(char *p, std::size_t alignment) {
+        auto v = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<char*>((v + alignment - 1) & ~(std::uintptr_t) (alignment - 1));
+    }
+
+    void* Arena::allocate(std::size_t size, std::size_t alignment) {
+        auto p = align_up(_current, alignment);
+        if (!_current || p + size > _end) {
+            grow(size + alignment);
+            p = align_up(_current, alignment);
+        }
+        _current = p + size;
+        _used   += size;
+        return p;
+    }
+
+    void Arena::grow(std::size_t min_size) {
+        // blocks double up to 64 times the first one, so large trees
+        // take few of them
+        auto size  = std::max(_block_size << std::min(_blocks, (std::size_t) 6), min_size + sizeof(Block));
+        auto block = static_cast<Block*>(std::malloc(size));
+        if (!block)
+            throw std::bad_alloc();
+        block->next = _head;
+        block->size = size;
+        _head       = block;
+        _current    = reinterpret_cast<char*>(block + 1);
+        _end        = reinterpret_cast<char*>(block) + size;
+        ++_blocks;
+        _reserved  += size;
+    }
+
+    void Arena::clear() {
+        while (_head) {
+            auto next = _head->next;
+            std::free(_head);
+            _head = next;
+        }
+        _current  = nullptr;
+        _end      = nullptr;
+        _blocks   = 0;
+        _reserved = 0;
+        _used     = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    // PoolResource
+    //------------------------------------------------------------------------------
+
+    void* PoolResource::allocate(std::size_t size) {
+        if (size == 0 || size > MAX_SMALL)
+            return ::operator new(size ? size : 1);
+        auto k = (size - 1) / GRANULE;
+        if (auto block = _free[k]) {
+            _free[k] = block->next;
+            return block;
+        }
+        return _arena.allocate((k + 1) * GRANULE, GRANULE);
+    }
+
+    void PoolResource::deallocate(void *p, std::size_t size) {
+        if (!p)
+            return;
+        if (size == 0 || size > MAX_SMALL) {
+            ::operator delete(p);
+            return;
+        }
+        auto k     = (size - 1) / GRANULE;
+        auto block = static_cast<FreeBlock*>(p);
+        block->next = _free[k];
+        _free[k]    = block;
+    }
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Arena
+    //------------------------------------------------------------------------------
+
+    /*! \brief bump allocator over a list of large blocks
+     *
+     * allocate() carves consecutive memory out of the current block and
+     * only goes to the heap when it runs out (each new block twice the
+     * previous, up to 64 times block_size), so objects created together
+     * sit together. Nothing is freed individually: clear() and the
+     * destructor release every block at once, without running destructors
+     * (see Pool for objects that need them).
+     */
+    struct Arena {
+    public:
+        Arena(std::size_t block_size=16*1024);
+        ~Arena();
+
+        Arena(const Arena& other) = delete;
+        Arena& operator=(const Arena& other) = delete;
+
+        Arena(Arena&& other);
+        Arena& operator=(Arena&& other);
+
+        void* allocate(std::size_t size, std::size_t alignment=alignof(std::max_align_t));
+
+        // releases all the blocks
+        void clear();
+
+        std::size_t blocks()   const { return _blocks; }
+        std::size_t reserved() const { return _reserved; } // bytes taken from the heap
+        std::size_t used()     const { return _used; }     // bytes handed out
+
+    private:
+        struct Block {
+            Block*      next;
+            std::size_t size;
+        };
+
+        void grow(std::size_t min_size);
+
+    private:
+        Block*      _head     { nullptr };
+        char*       _current  { nullptr };
+        char*       _end      { nullptr };
+        std::size_t _block_size;
+        std::size_t _blocks   { 0 };
+        std::size_t _reserved { 0 };
+        std::size_t _used     { 0 };
+    };
+
+    //------------------------------------------------------------------------------
+    // Pool
+    //------------------------------------------------------------------------------
+
+    /*! \brief objects of one type in an Arena, with a free list
+     *
+     * destroy() runs the destructor and keeps the memory for the next
+     * create(). clear() (and the destructor) drop all the memory at once
+     * without destroying the objects still alive: use it only when they
+     * need no destruction or were destroyed already.
+     */
+    template <typename T>
+    struct Pool {
+    public:
+        Pool(std::size_t objects_per_block=64): _arena(objects_per_block * sizeof(Cell)) {}
+
+        Pool(const Pool& other) = delete;
+        Pool& operator=(const Pool& other) = delete;
+
+        template <typename... Args>
+        T* create(Args&&... args) {
+            void *p;
+            if (_free) {
+                p     = _free;
+                _free = _free->next;
+            }
+            else {
+                p = _arena.allocate(sizeof(Cell), alignof(Cell));
+            }
+            ++_live;
+            return new (p) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T *object) {
+            if (!object)
+                return;
+            object->~T();
+            auto cell  = reinterpret_cast<Cell*>(object);
+            cell->next = _free;
+            _free      = cell;
+            --_live;
+        }
+
+        void clear() { _arena.clear(); _free = nullptr; _live = 0; }
+
+        std::size_t  live() const { return _live; }
+        const Arena& arena() const { return _arena; }
+
+    private:
+        union Cell {
+            Cell* next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+    private:
+        Arena       _arena;
+        Cell*       _free { nullptr };
+        std::size_t _live { 0 };
+    };
+
+    //------------------------------------------------------------------------------
+    // PoolResource
+    //------------------------------------------------------------------------------
+
+    /*! \brief small blocks of a few sizes (multiples of 16 bytes up to 256)
+     * from an Arena, one free list per size; larger requests go to the heap
+     *
+     * Backs PoolAllocator, for node based standard containers.
+     */
+    struct PoolResource {
+    public:
+        static const std::size_t GRANULE   = 16;
+        static const std::size_t MAX_SMALL = 256;
+
+    public:
+        PoolResource(std::size_t block_size=16*1024): _arena(block_size) {}
+
+        PoolResource(const PoolResource& other) = delete;
+        PoolResource& operator=(const PoolResource& other) = delete;
+
+        void* allocate(std::size_t size);
+        void  deallocate(void *p, std::size_t size);
+
+        const Arena& arena() const { return _arena; }
+
+    private:
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+    private:
+        Arena      _arena;
+        FreeBlock* _free[MAX_SMALL / GRANULE] { };
+    };
+
+    //------------------------------------------------------------------------------
+    // PoolAllocator
+    //------------------------------------------------------------------------------
+
+    // standard allocator over a shared PoolResource, which stays alive as
+    // long as a container (or a copy of the allocator) uses it
+    template <typename T>
+    struct PoolAllocator {
+    public:
+        using value_type = T;
+
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap            = std::true_type;
+
+        template <typename U>
+        struct rebind { using other = PoolAllocator<U>; };
+
+    public:
+        PoolAllocator(std::shared_ptr<PoolResource> resource): _resource(std::move(resource)) {}
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &other): _resource(other.shared()) {}
+
+        T* allocate(std::size_t n) {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+                throw std::bad_alloc();
+            return static_cast<T*>(_resource->allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T *p, std::size_t n) { _resource->deallocate(p, n * sizeof(T)); }
+
+        PoolResource* resource() const { return _resource.get(); }
+        const std::shared_ptr<PoolResource>& shared() const { return _resource; }
+
+    private:
+        std::shared_ptr<PoolResource> _resource;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.resource() == b.resource(); }
+
+    template <typename T, typename U>
+    bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b) { return a.resource() != b.resource(); }
+
+}
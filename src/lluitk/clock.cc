@@ -0,0 +1,26 @@
+#include "clock.hh"
+
+#include <chrono>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Clock
+    //------------------------------------------------------------------------------
+    
+    Microseconds SystemClock::now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    static SystemClock _system_clock;
+    static Clock*      _clock = &_system_clock;
+    
+    Clock& clock() {
+        return *_clock;
+    }
+    
+    void clock(Clock *c) {
+        _clock = c ? c : &_system_clock;
+    }
+    
+}
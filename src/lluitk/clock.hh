@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Timestamp: microseconds on a monotonic clock
+    //------------------------------------------------------------------------------
+    
+    using Microseconds = std::uint64_t;
+    
+    //------------------------------------------------------------------------------
+    // Clock
+    //------------------------------------------------------------------------------
+    
+    /*! \brief source of time for the whole toolkit (event stamps, App
+     * timestamps and timers, wheel acceleration)
+     *
+     * The system clock is used unless another one is installed, e.g. a
+     * ManualClock to replay a recorded session deterministically.
+     */
+    struct Clock {
+    public:
+        virtual ~Clock() {}
+        virtual Microseconds now() const = 0;
+    };
+    
+    struct SystemClock: public Clock {
+    public:
+        Microseconds now() const;
+    };
+    
+    struct ManualClock: public Clock {
+    public:
+        ManualClock(Microseconds t=0): _now(t) {}
+        
+        Microseconds now() const { return _now; }
+        
+        ManualClock& set(Microseconds t) { _now = t; return *this; }
+        ManualClock& advance(Microseconds dt) { _now += dt; return *this; }
+        
+    private:
+        Microseconds _now;
+    };
+    
+    // current clock
+    Clock& clock();
+    
+    // installs c as the current clock (nullptr: back to the system clock);
+    // the caller keeps ownership
+    void clock(Clock *c);
+    
+}
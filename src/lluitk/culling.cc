@@ -0,0 +1,117 @@
+#include "culling.hh"
+
+#include "damage.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Culler
+    //------------------------------------------------------------------------------
+
+    static bool covers(const Window &a, const Window &b) {
+        return a.x() <= b.x() && a.y() <= b.y() && b.X() <= a.X() && b.Y() <= a.Y();
+    }
+
+    void Culler::reset() {
+        _culled.clear();
+        _stats.reset();
+        _root = nullptr;
+        _valid = false;
+    }
+
+    void Culler::cull(std::size_t i, CullAction action, std::size_t &counter) {
+        auto &e = _entries[i];
+        e.action = (std::uint8_t) action;
+        _culled[e.widget] = (std::uint8_t) action;
+        counter += (action == CULL_SUBTREE) ? e.end - i : 1;
+    }
+
+    void Culler::update(Widget *root, const Window &viewport) {
+        reset();
+        _entries.clear();
+        _open.clear();
+        _occluders.clear();
+        _root           = root;
+        _layout_version = layoutVersion(root);
+        _valid = true;
+        if (!root)
+            return;
+
+        // entries in render order
+        _walker.walk(root,
+                     [this](Widget *w) {
+                         Entry e;
+                         e.widget     = w;
+                         e.has_bounds = w->bounds(e.bounds);
+                         e.opaque     = e.has_bounds && w->opaque();
+                         e.end        = _entries.size() + 1;
+                         e.action     = CULL_NONE;
+                         _entries.push_back(e);
+                         if (w->rendersChildren())
+                             return WALK_SKIP; // no post visit
+                         _open.push_back(_entries.size() - 1);
+                         return WALK_CONTINUE;
+                     },
+                     [this](Widget *w) {
+                         _entries[_open.back()].end = _entries.size();
+                         _open.pop_back();
+                     });
+        _stats.visited = _entries.size();
+
+        // offscreen and empty subtrees
+        for (std::size_t i=0;i<_entries.size();) {
+            auto &e = _entries[i];
+            if (e.has_bounds && area(e.bounds) <= 0.0) {
+                cull(i, CULL_SUBTREE, _stats.empty);
+                i = e.end;
+            }
+            else if (e.has_bounds && !intersects(e.bounds, viewport)) {
+                cull(i, CULL_SUBTREE, _stats.offscreen);
+                i = e.end;
+            }
+            else {
+                if (e.opaque)
+                    _occluders.push_back(i);
+                ++i;
+            }
+        }
+
+        // occlusion: the first occluder after i covering it decides
+        if (_occluders.empty())
+            return;
+        for (std::size_t i=0;i<_entries.size();) {
+            auto &e = _entries[i];
+            if (e.action != CULL_NONE || !e.has_bounds) {
+                i = (e.action == CULL_SUBTREE) ? e.end : i + 1;
+                continue;
+            }
+            auto action = CULL_NONE;
+            for (auto j: _occluders) {
+                if (j <= i || !covers(_entries[j].bounds, e.bounds))
+                    continue;
+                if (j >= e.end) {
+                    action = CULL_SUBTREE;
+                    break;
+                }
+                action = CULL_SELF; // a descendant covers it; keep looking for a later one
+            }
+            if (action == CULL_SUBTREE) {
+                cull(i, CULL_SUBTREE, _stats.occluded);
+                i = e.end;
+            }
+            else {
+                if (action == CULL_SELF)
+                    cull(i, CULL_SELF, _stats.occluded);
+                ++i;
+            }
+        }
+    }
+
+    CullAction Culler::test(Widget *w) const {
+        if (!_valid || _culled.empty() || _layout_version != layoutVersion(_root))
+            return CULL_NONE;
+        auto it = _culled.find(w);
+        return it == _culled.end() ? CULL_NONE : (CullAction) it->second;
+    }
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "geom.hh"
+#include "widget.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // CullStats
+    //------------------------------------------------------------------------------
+
+    // widgets of the render walk, by what happened to them (one frame)
+    struct CullStats {
+    public:
+        void reset() { *this = CullStats(); }
+
+        std::size_t culled() const { return offscreen + empty + occluded; }
+
+    public:
+        std::size_t visited   { 0 }; // widgets the render walk would reach
+        std::size_t offscreen { 0 }; // outside the viewport (with their subtree)
+        std::size_t empty     { 0 }; // zero area, e.g. hidden Grid2 slots (with their subtree)
+        std::size_t occluded  { 0 }; // covered by an opaque widget drawn later
+    };
+
+    //------------------------------------------------------------------------------
+    // Culler
+    //------------------------------------------------------------------------------
+
+    enum CullAction {
+        CULL_NONE,     // render as usual
+        CULL_SELF,     // skip pre_render/render of the widget only (covered by a descendant)
+        CULL_SUBTREE   // skip the widget, its subtree and its render_overlay
+    };
+
+    /*! \brief which widgets of a tree can't show in a frame
+     *
+     * update() walks the tree the way App renders it, in painter's order,
+     * and marks the widgets whose bounds are outside the viewport or have
+     * zero area (with their subtrees: children are assumed to lie within
+     * their parent's bounds, as the damage clipping already does) and the
+     * ones whose bounds are covered by an opaque() widget drawn after them.
+     *
+     * The result holds until the layout of the tree changes
+     * (layoutVersion(root), so other trees don't affect it); after that
+     * test() answers CULL_NONE until the next update(). The root has to
+     * outlive the result: reset() when it goes away.
+     */
+    struct Culler {
+    public:
+        Culler() = default;
+
+        Culler(const Culler& other) = delete;
+        Culler& operator=(const Culler& other) = delete;
+
+        void update(Widget *root, const Window &viewport);
+        void reset(); // nothing culled
+
+        CullAction test(Widget *w) const;
+
+        const CullStats& stats() const { return _stats; }
+
+    private:
+        struct Entry {
+            Widget*     widget;
+            Window      bounds;
+            std::size_t end;        // one past the last entry of the subtree
+            bool        has_bounds;
+            bool        opaque;
+            std::uint8_t action;
+        };
+
+        void cull(std::size_t i, CullAction action, std::size_t &counter);
+
+    private:
+        std::vector<Entry>                          _entries;   // pre-order
+        std::vector<std::size_t>                    _open;      // entries waiting for their post visit
+        std::vector<std::size_t>                    _occluders; // opaque entries not culled
+        std::unordered_map<Widget*, std::uint8_t>   _culled;
+        WidgetWalker                                _walker;
+        CullStats                                   _stats;
+        const Widget*                               _root { nullptr };
+        std::size_t                                 _layout_version { 0 };
+        bool                                        _valid { false };
+    };
+
+}
@@ -0,0 +1,129 @@
+#include "damage.hh"
+
+#include <algorithm>
+#include <limits>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Window helpers
+    //------------------------------------------------------------------------------
+
+    bool intersects(const Window &a, const Window &b) {
+        return a.x() < b.X() && b.x() < a.X() && a.y() < b.Y() && b.y() < a.Y();
+    }
+
+    Window intersection(const Window &a, const Window &b) {
+        if (!intersects(a, b))
+            return Window();
+        return Window(Vec2(std::max(a.x(), b.x()), std::max(a.y(), b.y())),
+                      Vec2(std::min(a.X(), b.X()), std::min(a.Y(), b.Y())));
+    }
+
+    Window unite(const Window &a, const Window &b) {
+        return Window(Vec2(std::min(a.x(), b.x()), std::min(a.y(), b.y())),
+                      Vec2(std::max(a.X(), b.X()), std::max(a.Y(), b.Y())));
+    }
+
+    double area(const Window &w) {
+        return (w.width() > 0.0 && w.height() > 0.0) ? w.width() * w.height() : 0.0;
+    }
+
+    //------------------------------------------------------------------------------
+    // DamageRegion
+    //------------------------------------------------------------------------------
+
+    void DamageRegion::add(const Window &rect) {
+        if (_full || lluitk::area(rect) <= 0.0)
+            return;
+
+        _rects[_count++] = rect;
+
+        // merge the new rectangle with the ones it overlaps (the union may
+        // in turn overlap others)
+        auto i = _count - 1;
+        auto merged = true;
+        while (merged) {
+            merged = false;
+            for (auto j=0;j<_count;++j) {
+                if (j != i && lluitk::intersects(_rects[i], _rects[j])) {
+                    merge(std::min(i,j), std::max(i,j));
+                    i = std::min(i,j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+
+        if (_count < MAX_RECTS)
+            return;
+
+        // full: merge the pair that grows the least
+        auto best_i = 0;
+        auto best_j = 1;
+        auto best   = std::numeric_limits<double>::max();
+        for (auto a=0;a<_count;++a) {
+            for (auto b=a+1;b<_count;++b) {
+                auto growth = lluitk::area(unite(_rects[a], _rects[b])) - lluitk::area(_rects[a]) - lluitk::area(_rects[b]);
+                if (growth < best) {
+                    best   = growth;
+                    best_i = a;
+                    best_j = b;
+                }
+            }
+        }
+        merge(best_i, best_j);
+    }
+
+    void DamageRegion::add(const DamageRegion &other) {
+        if (other._full) {
+            addAll();
+            return;
+        }
+        for (auto i=0;i<other._count;++i) {
+            add(other._rects[i]);
+        }
+    }
+
+    void DamageRegion::merge(int i, int j) {
+        _rects[i] = unite(_rects[i], _rects[j]);
+        _rects[j] = _rects[_count - 1];
+        --_count;
+    }
+
+    double DamageRegion::area() const {
+        double result = 0.0;
+        for (auto i=0;i<_count;++i) {
+            result += lluitk::area(_rects[i]);
+        }
+        return result;
+    }
+
+    bool DamageRegion::intersects(const Window &w) const {
+        if (_full)
+            return true;
+        for (auto i=0;i<_count;++i) {
+            if (lluitk::intersects(_rects[i], w))
+                return true;
+        }
+        return false;
+    }
+
+    //------------------------------------------------------------------------------
+    // DamageTracker
+    //------------------------------------------------------------------------------
+
+    DamageTracker::DamageTracker() {
+        addDamageObserver(this);
+    }
+
+    DamageTracker::~DamageTracker() {
+        removeDamageObserver(this);
+    }
+
+    void DamageTracker::damaged(Widget *root, const Window &rect) {
+        if (root == _root)
+            _pending.add(rect);
+    }
+
+}
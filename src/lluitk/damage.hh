@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include "geom.hh"
+#include "widget.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Window helpers
+    //------------------------------------------------------------------------------
+
+    bool   intersects(const Window &a, const Window &b);
+    Window intersection(const Window &a, const Window &b); // empty if disjoint
+    Window unite(const Window &a, const Window &b);
+    double area(const Window &w);                          // zero if empty
+
+    //------------------------------------------------------------------------------
+    // DamageRegion
+    //------------------------------------------------------------------------------
+
+    /*! \brief the part of a window that has to be drawn again, as a few
+     * rectangles
+     *
+     * Overlapping rectangles are merged; past MAX_RECTS the pair whose
+     * union adds the least area is merged. A full region stands for the
+     * whole window.
+     */
+    struct DamageRegion {
+    public:
+        static const int MAX_RECTS = 8;
+
+    public:
+        DamageRegion() = default;
+
+        void add(const Window &rect); // empty rectangles are ignored
+        void add(const DamageRegion &other);
+        void addAll() { _full = true; _count = 0; }
+        void clear() { _full = false; _count = 0; }
+
+        bool full() const { return _full; }
+        bool empty() const { return !_full && _count == 0; }
+
+        int           size() const { return _count; }
+        const Window& operator[](int i) const { return _rects[i]; }
+
+        double area() const; // sum of the rectangle areas (full: 0)
+
+        bool intersects(const Window &w) const;
+
+    private:
+        void merge(int i, int j);
+
+    private:
+        Window _rects[MAX_RECTS];
+        int    _count { 0 };
+        bool   _full { false };
+    };
+
+    //------------------------------------------------------------------------------
+    // DamageTracker
+    //------------------------------------------------------------------------------
+
+    /*! \brief collects the invalidate() calls that reach the root of a tree
+     */
+    struct DamageTracker: public DamageObserver {
+    public:
+        DamageTracker();
+        ~DamageTracker();
+
+        DamageTracker(const DamageTracker& other) = delete;
+        DamageTracker& operator=(const DamageTracker& other) = delete;
+
+        void          root(Widget *w) { _root = w; _pending.addAll(); }
+        Widget*       root() const { return _root; }
+
+        void          damaged(Widget *root, const Window &rect);
+
+        DamageRegion& pending() { return _pending; }
+        const DamageRegion& pending() const { return _pending; }
+
+    private:
+        Widget*      _root { nullptr };
+        DamageRegion _pending;
+    };
+
+}
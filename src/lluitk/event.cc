@@ -1,9 +1,12 @@
 #include "event.hh"
+#include "clock.hh"
 
 #include <sstream>
 #include <locale>
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <type_traits>
 
 namespace lluitk {
     
@@ -172,7 +175,149 @@ namespace lluitk {
         {}
         
         //------------------------------------------------------------------------------
-        // KeyRelease
+        // Modifiers mask
+        //------------------------------------------------------------------------------
+        
+        std::uint8_t modifiersMask(const Modifiers& m) {
+            return (std::uint8_t)
+            ((m.alt      ? 1 : 0) +
+            ((m.control ? 1 : 0) << 1) +
+            ((m.shift   ? 1 : 0) << 2) +
+            ((m.super   ? 1 : 0) << 3));
+        }
+        
+        Modifiers modifiersFromMask(std::uint8_t mask) {
+            bool alt     = mask & 0x1;
+            bool control = mask & 0x2;
+            bool shift   = mask & 0x4;
+            bool super   = mask & 0x8;
+            return Modifiers { shift, control, alt, super };
+        }
+        
+        //------------------------------------------------------------------------------
+        // Timestamp
+        //------------------------------------------------------------------------------
+        
+        Timestamp monotonicNow() {
+            return clock().now();
+        }
+        
+        //------------------------------------------------------------------------------
+        // EventRecord
+        //------------------------------------------------------------------------------
+        
+        static_assert(std::is_trivially_copyable<EventRecord>::value, "EventRecord should be trivially copyable");
+        
+        static EventRecord record(EventType type, const Modifiers& modifiers) {
+            EventRecord r;
+            std::memset(&r, 0, sizeof(EventRecord));
+            r.type           = type;
+            r.modifiers_mask = modifiersMask(modifiers);
+            return r;
+        }
+        
+        EventRecord EventRecord::mouseMove(const Point& position) {
+            auto r = record(EVENT_MOUSE_MOVE, Modifiers());
+            r.data.point.x = position.x();
+            r.data.point.y = position.y();
+            return r;
+        }
+        
+        EventRecord EventRecord::mouseWheel(const Point& delta, const Modifiers& modifiers) {
+            auto r = record(EVENT_MOUSE_WHEEL, modifiers);
+            r.data.point.x = delta.x();
+            r.data.point.y = delta.y();
+            return r;
+        }
+        
+        EventRecord EventRecord::mousePress(MouseButton button, const Modifiers& modifiers) {
+            auto r = record(EVENT_MOUSE_PRESS, modifiers);
+            r.data.button = (std::int32_t) button;
+            return r;
+        }
+        
+        EventRecord EventRecord::mouseRelease(MouseButton button, const Modifiers& modifiers) {
+            auto r = record(EVENT_MOUSE_RELEASE, modifiers);
+            r.data.button = (std::int32_t) button;
+            return r;
+        }
+        
+        EventRecord EventRecord::windowResize(const Size& new_size) {
+            auto r = record(EVENT_WINDOW_RESIZE, Modifiers());
+            r.data.point.x = new_size.x();
+            r.data.point.y = new_size.y();
+            return r;
+        }
+        
+        EventRecord EventRecord::keyPress(KeyCode key, const Modifiers& modifiers) {
+            auto r = record(EVENT_KEY_PRESS, modifiers);
+            r.data.key = (std::int32_t) key;
+            return r;
+        }
+        
+        EventRecord EventRecord::keyRelease(KeyCode key, const Modifiers& modifiers) {
+            auto r = record(EVENT_KEY_RELEASE, modifiers);
+            r.data.key = (std::int32_t) key;
+            return r;
+        }
+        
+        static EventRecord makeUnstampedRecord(const Event& e) {
+            switch (e.getType()) {
+                case EVENT_MOUSE_MOVE:
+                    return EventRecord::mouseMove(e.asMouseMove().position);
+                case EVENT_MOUSE_WHEEL:
+                    return EventRecord::mouseWheel(e.asMouseWheel().position, e.asMouseWheel().modifiers);
+                case EVENT_MOUSE_PRESS:
+                    return EventRecord::mousePress(e.asMousePress().button, e.asMousePress().modifiers);
+                case EVENT_MOUSE_RELEASE:
+                    return EventRecord::mouseRelease(e.asMouseRelease().button, e.asMouseRelease().modifiers);
+                case EVENT_WINDOW_RESIZE:
+                    return EventRecord::windowResize(e.asWindowResize().new_size);
+                case EVENT_KEY_PRESS:
+                    return EventRecord::keyPress(e.asKeyPress().key, e.asKeyPress().modifiers);
+                case EVENT_KEY_RELEASE:
+                    return EventRecord::keyRelease(e.asKeyRelease().key, e.asKeyRelease().modifiers);
+                default:
+                    return record(e.getType(), Modifiers());
+            }
+        }
+        
+        EventRecord makeRecord(const Event& e) {
+            return makeUnstampedRecord(e).stamp(e.timestamp).window(e.window);
+        }
+        
+        static std::unique_ptr<Event> makeUnstampedEvent(const EventRecord& r) {
+            switch (r.type) {
+                case EVENT_MOUSE_MOVE:
+                    return std::unique_ptr<Event> { new MouseMove { r.position() } };
+                case EVENT_MOUSE_WHEEL:
+                    return std::unique_ptr<Event> { new MouseWheel { r.delta(), r.modifiers() } };
+                case EVENT_MOUSE_PRESS:
+                    return std::unique_ptr<Event> { new MousePress { r.button(), r.modifiers() } };
+                case EVENT_MOUSE_RELEASE:
+                    return std::unique_ptr<Event> { new MouseRelease { r.button(), r.modifiers() } };
+                case EVENT_WINDOW_RESIZE:
+                    return std::unique_ptr<Event> { new WindowResize { r.size() } };
+                case EVENT_KEY_PRESS:
+                    return std::unique_ptr<Event> { new KeyPress { r.key(), r.modifiers() } };
+                case EVENT_KEY_RELEASE:
+                    return std::unique_ptr<Event> { new KeyRelease { r.key(), r.modifiers() } };
+                default:
+                    return std::unique_ptr<Event>();
+            }
+        }
+        
+        std::unique_ptr<Event> makeEvent(const EventRecord& r) {
+            auto e = makeUnstampedEvent(r);
+            if (e) {
+                e->timestamp = r.timestamp;
+                e->window    = r.window();
+            }
+            return e;
+        }
+        
+        //------------------------------------------------------------------------------
+        // Serialization
         //------------------------------------------------------------------------------
 
         std::ostream& write(std::ostream& os, const EventType &t) {
@@ -191,12 +336,7 @@ namespace lluitk {
         }
         
         std::ostream& write(std::ostream& os, const Modifiers &m) {
-            int modifier =
-            (m.alt      ? 1 : 0) +
-            ((m.control ? 1 : 0) << 1) +
-            ((m.shift   ? 1 : 0) << 2) +
-            ((m.super   ? 1 : 0) << 3);
-            os << "mod:" << (int) modifier << ";";
+            os << "mod:" << (int) modifiersMask(m) << ";";
             return os;
         }
 
@@ -205,6 +345,34 @@ namespace lluitk {
             return os;
         }
 
+        std::ostream& write(std::ostream& os, const Timestamp &t) {
+            os << "t:" << t << ";";
+            return os;
+        }
+        
+        std::ostream& write_window(std::ostream& os, int index) {
+            os << "w:" << index << ";";
+            return os;
+        }
+        
+        int read_window(std::istream& is) {
+            std::string lbl;
+            std::getline(is,lbl,':');
+            if (lbl.compare("w") != 0)
+                throw std::runtime_error("ooops");
+            std::getline(is,lbl,';');
+            return std::stoi(lbl);
+        }
+        
+        Timestamp read_Timestamp(std::istream& is) {
+            std::string lbl;
+            std::getline(is,lbl,':');
+            if (lbl.compare("t") != 0)
+                throw std::runtime_error("ooops");
+            std::getline(is,lbl,';');
+            return (Timestamp) std::stoull(lbl);
+        }
+        
         EventType read_EventType(std::istream& is) {
             std::string lbl;
             std::getline(is,lbl,':');
@@ -250,100 +418,122 @@ namespace lluitk {
             if (lbl.compare("mod") != 0)
                 throw std::runtime_error("ooops");
             std::getline(is,lbl,';');
-            
-            auto modifiers = std::stoi(lbl);
-            
-            bool alt     = modifiers & 0x1;
-            bool control = modifiers & 0x2;
-            bool shift   = modifiers & 0x4;
-            bool super   = modifiers & 0x8;
-
-            return Modifiers {
-                shift,
-                control,
-                alt,
-                super
-            };
+            return modifiersFromMask((std::uint8_t) std::stoi(lbl));
         }
 
-        //------------------------------------------------------------------------------
-        // KeyRelease
-        //------------------------------------------------------------------------------
-        
-        void writeEvent(std::ostream& os, const Event& e) {
-            auto etype = e.getType();
+        void writeEvent(std::ostream& os, const EventRecord& r) {
+            auto etype = r.type;
             write(os, etype);
-            if (etype == EVENT_MOUSE_PRESS) {
-                auto &ee = e.asMousePress();
-                write(os,ee.button);
-                write(os,ee.modifiers);
-            }
-            else if (etype == EVENT_MOUSE_RELEASE) {
-                auto &ee = e.asMouseRelease();
-                write(os,ee.button);
-                write(os,ee.modifiers);
+            if (etype == EVENT_MOUSE_PRESS || etype == EVENT_MOUSE_RELEASE) {
+                write(os,r.button());
+                write(os,r.modifiers());
             }
             else if (etype == EVENT_MOUSE_MOVE) {
-                auto &ee = e.asMouseMove();
-                write(os,ee.position);
+                write(os,r.position());
             }
-            else if (etype == EVENT_MOUSE_WHEEL) {
-                auto &ee = e.asMouseWheel();
-                write(os,ee.position);
-                write(os,ee.modifiers);
+            else if (etype == EVENT_WINDOW_RESIZE) {
+                write(os,r.size()); // p:width,height;
             }
-            else if (etype == EVENT_KEY_PRESS) {
-                auto &ee = e.asKeyPress();
-                write(os,ee.key);
-                write(os,ee.modifiers);
+            else if (etype == EVENT_MOUSE_WHEEL) {
+                write(os,r.delta());
+                write(os,r.modifiers());
             }
-            else if (etype == EVENT_KEY_RELEASE) {
-                auto &ee = e.asKeyRelease();
-                write(os,ee.key);
-                write(os,ee.modifiers);
+            else if (etype == EVENT_KEY_PRESS || etype == EVENT_KEY_RELEASE) {
+                write(os,r.key());
+                write(os,r.modifiers());
             }
             else {
                 // pass
             }
-            
+            // optional fields
+            if (r.window()) {
+                write_window(os,r.window());
+            }
+            if (r.timestamp) {
+                write(os,r.timestamp);
+            }
         }
         
-        std::unique_ptr<Event> readEvent(std::istream& is) {
+        bool readEvent(std::istream& is, EventRecord& r) {
             auto etype = read_EventType(is);
             if (etype == EVENT_MOUSE_PRESS) {
-                return std::unique_ptr<Event> {
-                    new MousePress { read_MouseButton(is), read_Modifiers(is) }
-                };
+                auto button = read_MouseButton(is);
+                r = EventRecord::mousePress(button, read_Modifiers(is));
             }
             else if (etype == EVENT_MOUSE_RELEASE) {
-                return std::unique_ptr<Event> {
-                    new MouseRelease { read_MouseButton(is), read_Modifiers(is) }
-                };
+                auto button = read_MouseButton(is);
+                r = EventRecord::mouseRelease(button, read_Modifiers(is));
             }
             else if (etype == EVENT_MOUSE_MOVE) {
-                return std::unique_ptr<Event> {
-                    new MouseMove { read_Point(is) }
-                };
+                r = EventRecord::mouseMove(read_Point(is));
+            }
+            else if (etype == EVENT_WINDOW_RESIZE) {
+                r = EventRecord::windowResize(read_Point(is));
             }
             else if (etype == EVENT_MOUSE_WHEEL) {
-                return std::unique_ptr<Event> {
-                    new MouseWheel { read_Point(is), read_Modifiers(is) }
-                };
+                auto delta = read_Point(is);
+                r = EventRecord::mouseWheel(delta, read_Modifiers(is));
             }
             else if (etype == EVENT_KEY_PRESS) {
-                return std::unique_ptr<Event> {
-                    new KeyPress { read_KeyCode(is), read_Modifiers(is) }
-                };
+                auto key = read_KeyCode(is);
+                r = EventRecord::keyPress(key, read_Modifiers(is));
             }
             else if (etype == EVENT_KEY_RELEASE) {
-                return std::unique_ptr<Event> {
-                    new KeyRelease { read_KeyCode(is), read_Modifiers(is) }
-                };
+                auto key = read_KeyCode(is);
+                r = EventRecord::keyRelease(key, read_Modifiers(is));
             }
             else {
-                // pass
+                return false;
+            }
+            if (is.peek() == 'w') {
+                r.window(read_window(is));
+            }
+            if (is.peek() == 't') {
+                r.timestamp = read_Timestamp(is);
+            }
+            return true;
+        }
+        
+        void writeEvent(std::ostream& os, const Event& e) {
+            writeEvent(os, makeRecord(e));
+        }
+        
+        std::unique_ptr<Event> readEvent(std::istream& is) {
+            EventRecord r;
+            if (!readEvent(is, r))
+                return std::unique_ptr<Event>();
+            return makeEvent(r);
+        }
+        
+        //------------------------------------------------------------------------------
+        // EventQueue
+        //------------------------------------------------------------------------------
+        
+        void EventQueue::push(const EventRecord& e) {
+            auto etype = e.type;
+            if (_pending.size() && _pending.back().type == etype && _pending.back().window_index == e.window_index) {
+                auto &last = _pending.back();
+                if (etype == EVENT_MOUSE_MOVE || etype == EVENT_WINDOW_RESIZE) {
+                    last.data.point = e.data.point;
+                    return;
+                }
+                else if (etype == EVENT_MOUSE_WHEEL && last.modifiers_mask == e.modifiers_mask) {
+                    last.data.point.x += e.data.point.x;
+                    last.data.point.y += e.data.point.y;
+                    return;
+                }
+            }
+            _pending.push_back(e);
+        }
+        
+        void EventQueue::drain(const Callback& callback) {
+            std::swap(_pending, _draining);
+            for (auto &e: _draining) {
+                if (callback)
+                    callback(e);
             }
-            return std::unique_ptr<Event>();
+            _draining.clear();
         }
+        
     }
-}
\ No newline at end of file
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
 #include "geom.hh"
 
 namespace lluitk {
@@ -158,6 +163,23 @@ namespace lluitk {
             bool         super   { false };
         };
         
+        //--------------------------------------------
+        // Timestamp
+        //--------------------------------------------
+        
+        // microseconds on a monotonic clock (0: unknown)
+        using Timestamp = std::uint64_t;
+        
+        Timestamp monotonicNow(); // lluitk::clock().now()
+        
+        //--------------------------------------------
+        // Modifiers
+        //--------------------------------------------
+        
+        // bitmask used by the serializers: alt=1, control=2, shift=4, super=8
+        std::uint8_t modifiersMask(const Modifiers& m);
+        Modifiers    modifiersFromMask(std::uint8_t mask);
+        
         //--------------------------------------------
         // Modifiers
         //--------------------------------------------
@@ -217,6 +239,8 @@ namespace lluitk {
 
         public:
             EventType type { EVENT_NULL };
+            Timestamp timestamp { 0 }; // when the os delivered it
+            int       window    { 0 }; // index of the window it came from
         };
         
         struct MouseMove: public Event {
@@ -290,13 +314,103 @@ namespace lluitk {
             Modifiers   modifiers;
         };
         
+        //--------------------------------------------
+        // EventRecord
+        //--------------------------------------------
+        
+        /*! \brief fixed size, trivially copyable value form of any event
+         *
+         * This is what the OS layer produces, the queues buffer, the
+         * serializers read and write and the App dispatches. The Event
+         * classes above are kept as adapters for code written against them
+         * (see makeRecord and makeEvent).
+         */
+        struct EventRecord {
+        public:
+            static EventRecord mouseMove(const Point& position);
+            static EventRecord mouseWheel(const Point& delta, const Modifiers& modifiers);
+            static EventRecord mousePress(MouseButton button, const Modifiers& modifiers);
+            static EventRecord mouseRelease(MouseButton button, const Modifiers& modifiers);
+            static EventRecord windowResize(const Size& new_size);
+            static EventRecord keyPress(KeyCode key, const Modifiers& modifiers);
+            static EventRecord keyRelease(KeyCode key, const Modifiers& modifiers);
+            
+        public:
+            EventType   getType() const { return type; }
+            
+            Point       position()  const { return Point { data.point.x, data.point.y }; } // move
+            Point       delta()     const { return Point { data.point.x, data.point.y }; } // wheel
+            Size        size()      const { return Point { data.point.x, data.point.y }; } // resize
+            MouseButton button()    const { return (MouseButton) data.button; }
+            KeyCode     key()       const { return (KeyCode) data.key; }
+            Modifiers   modifiers() const { return modifiersFromMask(modifiers_mask); }
+            
+            EventRecord& stamp(Timestamp t) { timestamp = t; return *this; }
+            
+            // index (creation order) of the window the event came from
+            int          window() const { return window_index; }
+            EventRecord& window(int index) { window_index = (std::uint16_t) index; return *this; }
+            
+        public:
+            EventType     type;
+            std::uint8_t  modifiers_mask;
+            std::uint16_t window_index;
+            union {
+                struct { double x; double y; } point; // position, wheel delta or new size
+                std::int32_t                   button;
+                std::int32_t                   key;
+            } data;
+            Timestamp     timestamp; // when the os delivered it (0: unknown)
+        };
+        
+        EventRecord            makeRecord(const Event& event);
+        std::unique_ptr<Event> makeEvent(const EventRecord& record);
+        
         //---------------
         // Serialization
         //---------------
         
+        void writeEvent(std::ostream& os, const EventRecord& record);
+        bool readEvent(std::istream& is, EventRecord& record); // false if no event could be read
+        
         void writeEvent(std::ostream& os, const Event& event);
         std::unique_ptr<Event> readEvent(std::istream& is);
         
+        //---------------
+        // EventQueue
+        //---------------
+        
+        /*! \brief buffers input events until they are drained (once per frame)
+         *
+         * Consecutive mouse moves collapse into the latest position,
+         * consecutive wheel events with the same modifiers add up their
+         * deltas and consecutive resizes keep the latest size. Presses,
+         * releases and keys keep their exact order. Events from different
+         * windows are never merged. A merged event keeps
+         * the timestamp of the first event merged into it, so latencies
+         * measured from it include the time spent in the queue.
+         */
+        struct EventQueue {
+        public:
+            using Callback = std::function<void(const EventRecord&)>;
+        public:
+            EventQueue() = default;
+            
+            void push(const EventRecord& e);
+            
+            // delivers every buffered event in order; events pushed while
+            // draining are kept for the next drain
+            void drain(const Callback& callback);
+            
+            std::size_t size() const { return _pending.size(); }
+            bool        empty() const { return _pending.empty(); }
+            void        clear() { _pending.clear(); }
+            
+        private:
+            std::vector<EventRecord> _pending;
+            std::vector<EventRecord> _draining;
+        };
+        
         
     } // event
     
@@ -0,0 +1,312 @@
+#include "event_log.hh"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lluitk {
+
+    namespace event {
+
+        //------------------------------------------------------------------------------
+        // little endian helpers
+        //------------------------------------------------------------------------------
+
+        static void put_u16(unsigned char *p, std::uint16_t v) {
+            p[0] = (unsigned char) (v & 0xff);
+            p[1] = (unsigned char) (v >> 8);
+        }
+
+        static void put_u32(unsigned char *p, std::uint32_t v) {
+            for (auto i=0;i<4;++i) {
+                p[i] = (unsigned char) ((v >> (8*i)) & 0xff);
+            }
+        }
+
+        static std::uint16_t get_u16(const unsigned char *p) {
+            return (std::uint16_t) (p[0] | (p[1] << 8));
+        }
+
+        static std::uint32_t get_u32(const unsigned char *p) {
+            return (std::uint32_t) p[0] | ((std::uint32_t) p[1] << 8) | ((std::uint32_t) p[2] << 16) | ((std::uint32_t) p[3] << 24);
+        }
+
+        static std::uint64_t double_bits(double v) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            return bits;
+        }
+
+        static double bits_double(std::uint64_t bits) {
+            double v;
+            std::memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+
+        static const std::uint8_t TAG_MASK      = 0x3f;
+        static const std::uint8_t TAG_UNSTAMPED = 0x40;
+        static const std::uint8_t TAG_ESCAPED   = 0x80;
+
+        static const double FIXED_ONE = 256.0;
+
+        //
+        // fixed point value of v relative to base, only if decoding it gives
+        // back v exactly
+        //
+        static bool fixed(double v, double base, std::int32_t &result) {
+            auto f = (v - base) * FIXED_ONE;
+            if (!(std::fabs(f) <= (double) std::numeric_limits<std::int32_t>::max()))
+                return false; // also rejects nan
+            auto i = (std::int32_t) std::lround(f);
+            if (base + i / FIXED_ONE != v)
+                return false;
+            result = i;
+            return true;
+        }
+
+        static bool has_point(EventType t) {
+            return t == EVENT_MOUSE_MOVE || t == EVENT_MOUSE_WHEEL || t == EVENT_WINDOW_RESIZE;
+        }
+
+        //------------------------------------------------------------------------------
+        // BinaryLogWriter
+        //------------------------------------------------------------------------------
+
+        BinaryLogWriter::BinaryLogWriter(std::ostream &os):
+        _os(os)
+        {
+            unsigned char header[BINARY_LOG_HEADER] = { 0 };
+            std::memcpy(header, BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+            put_u16(header + 8,  BINARY_LOG_VERSION);
+            put_u16(header + 10, (std::uint16_t) BINARY_LOG_RECORD);
+            _os.write((const char*) header, sizeof(header));
+        }
+
+        void BinaryLogWriter::put(std::uint8_t tag, std::uint8_t modifiers, std::uint16_t window, std::uint32_t dt, std::int32_t a, std::int32_t b) {
+            unsigned char record[BINARY_LOG_RECORD];
+            record[0] = tag;
+            record[1] = modifiers;
+            put_u16(record + 2,  window);
+            put_u32(record + 4,  dt);
+            put_u32(record + 8,  (std::uint32_t) a);
+            put_u32(record + 12, (std::uint32_t) b);
+            _os.write((const char*) record, sizeof(record));
+            ++_records;
+        }
+
+        void BinaryLogWriter::putDouble(LogTag tag, double value) {
+            auto bits = double_bits(value);
+            put(tag, 0, 0, 0, (std::int32_t) (std::uint32_t) bits, (std::int32_t) (std::uint32_t) (bits >> 32));
+        }
+
+        void BinaryLogWriter::write(const EventRecord &r) {
+            std::uint8_t  tag = (std::uint8_t) r.type & TAG_MASK;
+            std::uint32_t dt  = 0;
+
+            if (!r.timestamp) {
+                tag |= TAG_UNSTAMPED;
+            }
+            else if (r.timestamp >= _last_timestamp && r.timestamp - _last_timestamp <= std::numeric_limits<std::uint32_t>::max()) {
+                dt = (std::uint32_t) (r.timestamp - _last_timestamp);
+                _last_timestamp = r.timestamp;
+            }
+            else {
+                put(LOG_TIME, 0, 0, 0, (std::int32_t) (std::uint32_t) r.timestamp, (std::int32_t) (std::uint32_t) (r.timestamp >> 32));
+                _last_timestamp = r.timestamp;
+            }
+
+            std::int32_t a = 0;
+            std::int32_t b = 0;
+            if (has_point(r.type)) {
+                auto x = r.data.point.x;
+                auto y = r.data.point.y;
+                auto move   = r.type == EVENT_MOUSE_MOVE;
+                auto base_x = move ? _last_x : 0.0;
+                auto base_y = move ? _last_y : 0.0;
+                if (!fixed(x, base_x, a) || !fixed(y, base_y, b)) {
+                    putDouble(LOG_X, x);
+                    putDouble(LOG_Y, y);
+                    tag |= TAG_ESCAPED;
+                    a = 0;
+                    b = 0;
+                }
+                if (move) {
+                    _last_x = x;
+                    _last_y = y;
+                }
+            }
+            else if (r.type == EVENT_MOUSE_PRESS || r.type == EVENT_MOUSE_RELEASE) {
+                a = r.data.button;
+            }
+            else if (r.type == EVENT_KEY_PRESS || r.type == EVENT_KEY_RELEASE) {
+                a = r.data.key;
+            }
+
+            put(tag, r.modifiers_mask, r.window_index, dt, a, b);
+        }
+
+        //------------------------------------------------------------------------------
+        // BinaryLogReader
+        //------------------------------------------------------------------------------
+
+        BinaryLogReader::BinaryLogReader(const void *data, std::size_t size):
+        _begin((const unsigned char*) data),
+        _end((const unsigned char*) data + size),
+        _current((const unsigned char*) data)
+        {
+            if (size < BINARY_LOG_HEADER || std::memcmp(_begin, BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)) != 0)
+                throw std::runtime_error("not a binary event log");
+            _version     = get_u16(_begin + 8);
+            _record_size = get_u16(_begin + 10);
+            if (_version > BINARY_LOG_VERSION || _record_size < BINARY_LOG_RECORD)
+                throw std::runtime_error("unsupported binary event log version");
+            _current = _begin + BINARY_LOG_HEADER;
+        }
+
+        bool BinaryLogReader::next(EventRecord &r) {
+            while ((std::size_t) (_end - _current) >= _record_size) {
+                auto p = _current;
+                _current += _record_size;
+
+                auto tag = p[0];
+                auto a   = get_u32(p + 8);
+                auto b   = get_u32(p + 12);
+
+                switch (tag) {
+                    case LOG_TIME:
+                        _last_timestamp = (Timestamp) a | ((Timestamp) b << 32);
+                        continue;
+                    case LOG_X:
+                        _escaped_x = bits_double((std::uint64_t) a | ((std::uint64_t) b << 32));
+                        continue;
+                    case LOG_Y:
+                        _escaped_y = bits_double((std::uint64_t) a | ((std::uint64_t) b << 32));
+                        continue;
+                    default:
+                        break;
+                }
+
+                std::memset(&r, 0, sizeof(EventRecord));
+                r.type           = (EventType) (tag & TAG_MASK);
+                r.modifiers_mask = p[1];
+                r.window_index   = get_u16(p + 2);
+                if (!(tag & TAG_UNSTAMPED)) {
+                    _last_timestamp += get_u32(p + 4);
+                    r.timestamp = _last_timestamp;
+                }
+
+                if (has_point(r.type)) {
+                    auto move = r.type == EVENT_MOUSE_MOVE;
+                    if (tag & TAG_ESCAPED) {
+                        r.data.point.x = _escaped_x;
+                        r.data.point.y = _escaped_y;
+                    }
+                    else {
+                        r.data.point.x = (move ? _last_x : 0.0) + (std::int32_t) a / FIXED_ONE;
+                        r.data.point.y = (move ? _last_y : 0.0) + (std::int32_t) b / FIXED_ONE;
+                    }
+                    if (move) {
+                        _last_x = r.data.point.x;
+                        _last_y = r.data.point.y;
+                    }
+                }
+                else if (r.type == EVENT_MOUSE_PRESS || r.type == EVENT_MOUSE_RELEASE) {
+                    r.data.button = (std::int32_t) a;
+                }
+                else if (r.type == EVENT_KEY_PRESS || r.type == EVENT_KEY_RELEASE) {
+                    r.data.key = (std::int32_t) a;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------------
+        // MappedFile
+        //------------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+        MappedFile::MappedFile(const std::string &path) {
+            auto fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("could not open " + path);
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                throw std::runtime_error("could not stat " + path);
+            }
+            _size = (std::size_t) st.st_size;
+            if (_size) {
+                auto p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("could not map " + path);
+                }
+                ::madvise(p, _size, MADV_SEQUENTIAL);
+                _data = p;
+            }
+            ::close(fd);
+        }
+
+        MappedFile::~MappedFile() {
+            if (_data && _buffer.empty())
+                ::munmap(const_cast<void*>(_data), _size);
+        }
+
+#else
+
+        MappedFile::MappedFile(const std::string &path) {
+            std::ifstream is(path, std::ios::binary);
+            if (!is)
+                throw std::runtime_error("could not open " + path);
+            _buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+            _data = _buffer.data();
+            _size = _buffer.size();
+        }
+
+        MappedFile::~MappedFile() {}
+
+#endif
+
+        //------------------------------------------------------------------------------
+        // Converters
+        //------------------------------------------------------------------------------
+
+        std::size_t textToBinary(std::istream &text, std::ostream &binary) {
+            BinaryLogWriter writer(binary);
+            EventRecord r;
+            std::size_t count = 0;
+            while ((text >> std::ws).peek() != std::char_traits<char>::eof()) {
+                if (!readEvent(text, r))
+                    throw std::runtime_error("unknown event type in text event log");
+                writer.write(r);
+                ++count;
+            }
+            return count;
+        }
+
+        std::size_t binaryToText(const void *data, std::size_t size, std::ostream &text) {
+            BinaryLogReader reader(data, size);
+            EventRecord r;
+            std::size_t count = 0;
+            while (reader.next(r)) {
+                writeEvent(text, r);
+                ++count;
+            }
+            return count;
+        }
+
+    } // event
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "event.hh"
+
+namespace lluitk {
+
+    namespace event {
+
+        //--------------------------------------------
+        // Binary Event Log
+        //--------------------------------------------
+
+        /*
+         * Layout (little endian):
+         *
+         *     header  16 bytes: "LLEVLOG\0" | u16 version | u16 record size | u32 0
+         *     records 16 bytes: u8 tag | u8 modifiers | u16 window | u32 dt | i32 a | i32 b
+         *
+         * The low 6 bits of tag are the EventType (or one of the LOG_* control
+         * tags below), bit 0x40 marks an event without timestamp and bit 0x80
+         * an event whose coordinates came in the LOG_X/LOG_Y records just
+         * before it.
+         *
+         * dt is the number of microseconds since the previous stamped event
+         * (a LOG_TIME record resets the base when it doesn't fit). Coordinates
+         * are fixed point with 8 fractional bits: mouse moves store the delta
+         * to the previous move, wheel deltas and sizes are absolute. Anything
+         * that wouldn't round trip exactly is escaped with LOG_X/LOG_Y, which
+         * carry the raw bits of a double in (a,b), so the log is lossless.
+         * a is the button or key code of press/release/key events.
+         */
+
+        static const char          BINARY_LOG_MAGIC[8]   = { 'L','L','E','V','L','O','G','\0' };
+        static const std::uint16_t BINARY_LOG_VERSION    = 1;
+        static const std::size_t   BINARY_LOG_HEADER     = 16;
+        static const std::size_t   BINARY_LOG_RECORD     = 16;
+
+        enum LogTag {
+            LOG_TIME = 0x20, // (a,b): low and high 32 bits of an absolute timestamp
+            LOG_X    = 0x21, // (a,b): bits of the x coordinate of the next event
+            LOG_Y    = 0x22  // (a,b): bits of the y coordinate of the next event
+        };
+
+        //--------------------------------------------
+        // BinaryLogWriter
+        //--------------------------------------------
+
+        struct BinaryLogWriter {
+        public:
+            BinaryLogWriter(std::ostream &os); // writes the header
+
+            void write(const EventRecord &r);
+
+            std::size_t records() const { return _records; } // including control records
+
+        private:
+            void put(std::uint8_t tag, std::uint8_t modifiers, std::uint16_t window, std::uint32_t dt, std::int32_t a, std::int32_t b);
+            void putDouble(LogTag tag, double value);
+
+        private:
+            std::ostream  &_os;
+            std::size_t    _records { 0 };
+            Timestamp      _last_timestamp { 0 };
+            double         _last_x { 0.0 }; // last mouse move
+            double         _last_y { 0.0 };
+        };
+
+        //--------------------------------------------
+        // BinaryLogReader
+        //--------------------------------------------
+
+        /*! \brief iterates the events of a binary log in memory (e.g. a
+         * MappedFile) without allocating
+         */
+        struct BinaryLogReader {
+        public:
+            BinaryLogReader(const void *data, std::size_t size); // throws if the header is not valid
+
+            bool next(EventRecord &r); // false at the end (a truncated last record is ignored)
+
+            std::uint16_t version() const { return _version; }
+
+        private:
+            const unsigned char *_begin;
+            const unsigned char *_end;
+            const unsigned char *_current;
+            std::uint16_t        _version { 0 };
+            std::size_t          _record_size { BINARY_LOG_RECORD };
+            Timestamp            _last_timestamp { 0 };
+            double               _last_x { 0.0 };
+            double               _last_y { 0.0 };
+            double               _escaped_x { 0.0 };
+            double               _escaped_y { 0.0 };
+        };
+
+        //--------------------------------------------
+        // MappedFile
+        //--------------------------------------------
+
+        /*! \brief read-only view of a whole file: mmap on POSIX, read into
+         * memory elsewhere
+         */
+        struct MappedFile {
+        public:
+            MappedFile(const std::string &path); // throws if the file can't be read
+            ~MappedFile();
+
+            MappedFile(const MappedFile& other) = delete;
+            MappedFile& operator=(const MappedFile& other) = delete;
+
+            const void* data() const { return _data; }
+            std::size_t size() const { return _size; }
+
+        private:
+            const void*       _data { nullptr };
+            std::size_t       _size { 0 };
+            std::vector<char> _buffer; // when not mapped
+        };
+
+        //--------------------------------------------
+        // Converters
+        //--------------------------------------------
+
+        // returns the number of events converted; textToBinary throws on an
+        // event type the text format doesn't know
+        std::size_t textToBinary(std::istream &text, std::ostream &binary);
+        std::size_t binaryToText(const void *data, std::size_t size, std::ostream &text);
+
+    } // event
+
+}
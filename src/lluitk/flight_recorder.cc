@@ -0,0 +1,217 @@
+#include "flight_recorder.hh"
+
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace lluitk {
+
+    static_assert(std::is_trivially_copyable<FlightRecord>::value, "FlightRecord should be trivially copyable");
+
+    //------------------------------------------------------------------------------
+    // Dump header
+    //------------------------------------------------------------------------------
+
+    static const char FLIGHT_MAGIC[8] = { 'L','L','F','L','I','G','H','T' };
+    static const std::uint16_t FLIGHT_VERSION = 1;
+
+    struct FlightDumpHeader {
+        char          magic[8];
+        std::uint16_t version;
+        std::uint16_t record_size;
+        std::uint32_t capacity;
+    };
+
+    //------------------------------------------------------------------------------
+    // FlightRecorder
+    //------------------------------------------------------------------------------
+
+    FlightRecorder::FlightRecorder(std::size_t capacity) {
+        std::size_t n = 1;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        _slots.reset(new FlightRecord[n]);
+        std::memset(_slots.get(), 0, n * sizeof(FlightRecord));
+        _mask = n - 1;
+    }
+
+    void FlightRecorder::record(FlightKind kind, const void *widget, std::uint32_t value, const event::EventRecord *e) {
+        auto sequence = _next.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto &slot    = _slots[(sequence - 1) & _mask];
+
+        // readers (a dump, maybe from a signal handler) skip the slot until
+        // its sequence is set again
+        slot.sequence = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.time   = clock().now();
+        slot.kind   = kind;
+        slot.value  = value;
+        slot.widget = (std::uint64_t) (std::uintptr_t) widget;
+        if (e)
+            slot.event = *e;
+        else
+            std::memset(&slot.event, 0, sizeof(slot.event));
+
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.sequence = sequence;
+    }
+
+    void FlightRecorder::input(const event::EventRecord &e) {
+        record(FLIGHT_INPUT, nullptr, 0, &e);
+    }
+
+    void FlightRecorder::dispatch(const void *widget, event::EventType type) {
+        record(FLIGHT_DISPATCH, widget, (std::uint32_t) type, nullptr);
+    }
+
+    void FlightRecorder::frameBegin() {
+        record(FLIGHT_FRAME_BEGIN, nullptr, 0, nullptr);
+    }
+
+    void FlightRecorder::frameEnd(Microseconds duration) {
+        record(FLIGHT_FRAME_END, nullptr, (std::uint32_t) std::min<Microseconds>(duration, 0xffffffffu), nullptr);
+    }
+
+    void FlightRecorder::layout(const void *widget, Microseconds duration) {
+        record(FLIGHT_LAYOUT, widget, (std::uint32_t) std::min<Microseconds>(duration, 0xffffffffu), nullptr);
+    }
+
+    static bool write_all(int fd, const void *data, std::size_t size) {
+        auto p = (const char*) data;
+        while (size) {
+#ifndef _WIN32
+            auto n = ::write(fd, p, size);
+#else
+            auto n = ::_write(fd, p, (unsigned int) size);
+#endif
+            if (n <= 0)
+                return false;
+            p    += n;
+            size -= (std::size_t) n;
+        }
+        return true;
+    }
+
+    bool FlightRecorder::dump(int fd) const {
+        FlightDumpHeader header;
+        std::memcpy(header.magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC));
+        header.version     = FLIGHT_VERSION;
+        header.record_size = (std::uint16_t) sizeof(FlightRecord);
+        header.capacity    = (std::uint32_t) capacity();
+        return write_all(fd, &header, sizeof(header)) && write_all(fd, _slots.get(), capacity() * sizeof(FlightRecord));
+    }
+
+    //
+    // signal handler state: a handler can't allocate or lock, so the path is
+    // copied up front
+    //
+    static const int             MAX_SIGNAL = 64;
+    static const FlightRecorder* _signal_recorder = nullptr;
+    static char                  _signal_path[1024];
+    static bool                  _signal_fatal[MAX_SIGNAL];
+    static bool                  _signal_installed[MAX_SIGNAL];
+
+    static void dump_signal_handler(int signum) {
+        if (_signal_recorder) {
+#ifndef _WIN32
+            auto fd = ::open(_signal_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#else
+            auto fd = ::_open(_signal_path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#endif
+            if (fd >= 0) {
+                _signal_recorder->dump(fd);
+#ifndef _WIN32
+                ::close(fd);
+#else
+                ::_close(fd);
+#endif
+            }
+        }
+        if (signum >= 0 && signum < MAX_SIGNAL && !_signal_fatal[signum]) {
+            std::signal(signum, dump_signal_handler); // some platforms reset it
+            return;
+        }
+        std::signal(signum, SIG_DFL);
+        std::raise(signum);
+    }
+
+    void FlightRecorder::dumpOnSignal(int signum, const char *path, bool fatal) {
+        if (signum < 0 || signum >= MAX_SIGNAL)
+            return;
+        std::strncpy(_signal_path, path, sizeof(_signal_path) - 1);
+        _signal_path[sizeof(_signal_path) - 1] = 0;
+        _signal_recorder          = this;
+        _signal_fatal[signum]     = fatal;
+        _signal_installed[signum] = true;
+        std::signal(signum, dump_signal_handler);
+    }
+    
+    FlightRecorder::~FlightRecorder() {
+        if (_signal_recorder != this)
+            return;
+        // no dump from freed memory on a later signal (e.g. during static teardown)
+        for (auto signum=0;signum<MAX_SIGNAL;++signum) {
+            if (_signal_installed[signum]) {
+                std::signal(signum, SIG_DFL);
+                _signal_installed[signum] = false;
+            }
+        }
+        _signal_recorder = nullptr;
+    }
+
+    //------------------------------------------------------------------------------
+    // Dump readers
+    //------------------------------------------------------------------------------
+
+    bool readFlightDump(const void *data, std::size_t size, std::vector<FlightRecord> &records) {
+        FlightDumpHeader header;
+        if (size < sizeof(header))
+            return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC)) != 0 ||
+            header.version != FLIGHT_VERSION ||
+            header.record_size != sizeof(FlightRecord))
+            return false;
+
+        auto p     = (const char*) data + sizeof(header);
+        auto count = std::min<std::size_t>(header.capacity, (size - sizeof(header)) / sizeof(FlightRecord));
+
+        records.clear();
+        for (std::size_t i=0;i<count;++i) {
+            FlightRecord r;
+            std::memcpy(&r, p + i * sizeof(FlightRecord), sizeof(FlightRecord));
+            if (r.sequence && r.kind != FLIGHT_EMPTY)
+                records.push_back(r);
+        }
+        std::sort(records.begin(), records.end(), [](const FlightRecord& a, const FlightRecord& b) {
+            return a.sequence < b.sequence;
+        });
+        return true;
+    }
+
+    std::size_t flightDumpToText(const void *data, std::size_t size, std::ostream &os) {
+        std::vector<FlightRecord> records;
+        if (!readFlightDump(data, size, records))
+            return 0;
+        std::size_t count = 0;
+        for (auto &r: records) {
+            if (r.kind == FLIGHT_INPUT) {
+                event::writeEvent(os, r.event);
+                ++count;
+            }
+        }
+        return count;
+    }
+
+}
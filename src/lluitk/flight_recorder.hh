@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "clock.hh"
+#include "event.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // FlightKind
+    //------------------------------------------------------------------------------
+
+    enum FlightKind {
+        FLIGHT_EMPTY,
+        FLIGHT_INPUT,       // event: the input event as received by App
+        FLIGHT_DISPATCH,    // widget: deepest widget the event reached, value: event type
+        FLIGHT_FRAME_BEGIN,
+        FLIGHT_FRAME_END,   // value: frame duration (us)
+        FLIGHT_LAYOUT       // widget: root laid out, value: duration (us)
+    };
+
+    //------------------------------------------------------------------------------
+    // FlightRecord
+    //------------------------------------------------------------------------------
+
+    struct FlightRecord {
+    public:
+        std::uint64_t      sequence; // write order, starting at 1 (0: slot being written or empty)
+        Microseconds       time;     // clock()
+        std::uint32_t      kind;
+        std::uint32_t      value;
+        std::uint64_t      widget;   // address, for correlating records only
+        event::EventRecord event;
+    };
+
+    //------------------------------------------------------------------------------
+    // FlightRecorder
+    //------------------------------------------------------------------------------
+
+    /*! \brief fixed memory ring of the most recent input, dispatch, frame and
+     * layout records
+     *
+     * All memory is allocated up front. Recording claims a slot with one
+     * atomic increment and fills it in place (no locks, no allocation), so
+     * it is cheap enough to stay on in production. The oldest records are
+     * overwritten; how many seconds the ring covers depends on its capacity
+     * and the event rate.
+     *
+     * dump() only uses write(2) on the slots as they are, so it can run from
+     * a signal handler; readers sort the records by sequence and drop the
+     * slots that were being written at the time.
+     */
+    struct FlightRecorder {
+    public:
+        FlightRecorder(std::size_t capacity=4096); // rounded up to a power of two
+        ~FlightRecorder(); // uninstalls its dumpOnSignal handlers
+
+        FlightRecorder(const FlightRecorder& other) = delete;
+        FlightRecorder& operator=(const FlightRecorder& other) = delete;
+
+        void input(const event::EventRecord &e);
+        void dispatch(const void *widget, event::EventType type);
+        void frameBegin();
+        void frameEnd(Microseconds duration);
+        void layout(const void *widget, Microseconds duration);
+
+        std::size_t   capacity() const { return _mask + 1; }
+        std::uint64_t recorded() const { return _next.load(std::memory_order_relaxed); }
+
+        // compact dump: header followed by the raw slots (async-signal-safe)
+        bool dump(int fd) const;
+
+        // dump to path when signum is raised. A fatal signal (SIGSEGV,
+        // SIGABRT, ...) is then raised again with its default action; a non
+        // fatal one (e.g. SIGUSR1) gives an on-demand dump and execution goes on
+        void dumpOnSignal(int signum, const char *path, bool fatal=true);
+
+    private:
+        void record(FlightKind kind, const void *widget, std::uint32_t value, const event::EventRecord *e);
+
+    private:
+        std::unique_ptr<FlightRecord[]> _slots;
+        std::size_t                     _mask;
+        std::atomic<std::uint64_t>      _next { 0 };
+    };
+
+    //------------------------------------------------------------------------------
+    // Dump readers
+    //------------------------------------------------------------------------------
+
+    // valid records of a dump, oldest first (false if data is not a dump)
+    bool readFlightDump(const void *data, std::size_t size, std::vector<FlightRecord> &records);
+
+    // input events of a dump in the event::writeEvent text format, which
+    // Replay::run reads back (resizes keep their size); returns the number
+    // of events written
+    std::size_t flightDumpToText(const void *data, std::size_t size, std::ostream &os);
+
+}
@@ -5,6 +5,8 @@
 
 #include "d3cpp.hh"
 #include "app.hh"
+#include "render_batch.hh"
+#include "tree_stats.hh"
 
 namespace lluitk {
 
@@ -50,6 +52,93 @@ namespace lluitk {
         return _x == other._x && _y == other._y;
     }
 
+    //--------------------------------------------------------------------------
+    // CellArray
+    //--------------------------------------------------------------------------
+
+    static int lowestBit(std::uint64_t bits) { // bits != 0
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        int i = 0;
+        while (!(bits & 1)) { bits >>= 1; ++i; }
+        return i;
+#endif
+    }
+
+    static int highestBit(std::uint64_t bits) { // bits != 0
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(bits);
+#else
+        int i = 0;
+        while (bits >>= 1) ++i;
+        return i;
+#endif
+    }
+
+    CellArray::CellArray(const GridSize& size):
+        _size(size),
+        _cells((std::size_t) size.x() * size.y(), nullptr),
+        _occupied((_cells.size() + 63) / 64, 0)
+    {}
+
+    bool CellArray::inside(const GridPoint& p) const {
+        return p.x() >= 0 && p.y() >= 0 && p.x() < _size.x() && p.y() < _size.y();
+    }
+
+    std::size_t CellArray::checked(const GridPoint& p) const {
+        if (!inside(p))
+            throw std::runtime_error("grid cell out of range");
+        return index(p);
+    }
+
+    Widget* CellArray::get(const GridPoint& p) const {
+        return _cells[checked(p)];
+    }
+
+    void CellArray::set(const GridPoint& p, Widget* widget) {
+        auto i = checked(p);
+        _cells[i] = widget;
+        if (widget)
+            _occupied[i / 64] |= (std::uint64_t) 1 << (i % 64);
+        else
+            _occupied[i / 64] &= ~((std::uint64_t) 1 << (i % 64));
+    }
+
+    void CellArray::swap(const GridPoint& p0, const GridPoint& p1) {
+        auto w0 = get(p0);
+        auto w1 = get(p1);
+        set(p0, w1);
+        set(p1, w0);
+    }
+
+    std::size_t CellArray::next(std::size_t index) const {
+        if (index >= _cells.size())
+            return _cells.size();
+        auto word = index / 64;
+        auto bits = _occupied[word] & (~(std::uint64_t) 0 << (index % 64));
+        while (!bits) {
+            if (++word == _occupied.size())
+                return _cells.size();
+            bits = _occupied[word];
+        }
+        return word * 64 + lowestBit(bits);
+    }
+
+    std::size_t CellArray::previous(std::size_t end) const {
+        if (end == 0)
+            return 0;
+        auto last = std::min(end, _cells.size()) - 1;
+        auto word = last / 64;
+        auto bits = _occupied[word] & (~(std::uint64_t) 0 >> (63 - last % 64));
+        while (!bits) {
+            if (word == 0)
+                return 0;
+            bits = _occupied[--word];
+        }
+        return word * 64 + highestBit(bits) + 1;
+    }
+
     //--------------------------------------------------------------------------
     // Spring
     //--------------------------------------------------------------------------
@@ -198,8 +287,10 @@ namespace lluitk {
     //--------------------------------------------------------------------------
 
     Grid::Grid(const GridSize& size):
-        size(size)
+        size(size),
+        cells(size)
     {
+        _kinds |= widget_kind | WIDGET_CONTAINER | WIDGET_LAYOUT_THREAD_SAFE | WIDGET_RENDER_ON_DEMAND;
 
         if (size.x() == 0 || size.y() == 0)
             throw std::runtime_error("grid needs at leas one cell");
@@ -220,21 +311,33 @@ namespace lluitk {
     }
     
     void Grid::setCellWidget(const GridPoint& cell, Widget* widget) {
-        cell_map[cell] = widget;
+        auto current = cells.get(cell);
+        if (current && current != widget && current->parent() == this) {
+            current->parent(nullptr);
+        }
+        cells.set(cell, widget);
+        if (widget) {
+            widget->parent(this);
+        }
+        invalidateLayout();
+        notifyLayoutChanged(this);
     }
     
     void Grid::swapWidget(const GridPoint& cell0, const GridPoint& cell1) {
-        std::swap(cell_map[cell0],cell_map[cell1]);
+        cells.swap(cell0, cell1);
+        invalidateLayout();
+        notifyLayoutChanged(this);
     }
 
     void Grid::sizeHint(const Window &window) {
         this->window = window;
         this->layout();
         
-        for (auto &it: cell_map) {
+        _layout_items.clear();
+        for (auto i=cells.next(0);i<cells.size();i=cells.next(i+1)) {
             
-            auto &cell  = it.first;
-            auto widget = it.second;
+            auto cell   = cells.point(i);
+            auto widget = cells[i];
             
             auto &hseg = horizontal_segments[1 + 2 * cell.x()];
             auto &vseg = vertical_segments[1 + 2 * cell.y()];
@@ -243,38 +346,23 @@ namespace lluitk {
             auto wmin = window.min() + Point{hseg.p0(), vseg.p0()};
             Window w { wmin, wmin + Point{hseg.size(), vseg.size()} };
             
-            widget->sizeHint(w);
+            _layout_items.push_back(LayoutItem(widget, w));
         }
+        lluitk::arrange(_layout_items.data(), _layout_items.size());
         
         canvas.markDirty(true);
+        notifyLayoutChanged(this);
     }
     
     
-    void Grid::pre_render() {
-        
-        // some opengl effect must be computed here
-        
-        auto it = children();
-        Widget* child;
-        while ((child =it.next())) {
-            child->pre_render();
-        }
-    }
-
     void Grid::render() {
-        auto &renderer = llsg::opengl::getRenderer();
         bool clear = _grid_style.clear();
         if (clear) {
-            renderer.clear_color(_grid_style.clear_color());
-            renderer.clear(window);
-        }
-        
-        auto it = children();
-        Widget* child;
-        while ((child=it.next())) {
-            child->render();
+            submitClear(_grid_style.clear_color(), window);
         }
+    }
 
+    void Grid::render_overlay() {
         //
         // draw the handles after the content
         //
@@ -282,7 +370,16 @@ namespace lluitk {
         if (canvas.dirty) {
             prepareCanvas();
         }
-        renderer.render(canvas.root, llsg::Transform(), window);
+        submitRender(canvas.root, llsg::Transform(), window, true, &canvas_list);
+    }
+
+    void Grid::memoryUsage(MemoryUsage &usage) const {
+        SimpleWidget::memoryUsage(usage);
+        usage.object = sizeof(Grid);
+        usage.nodes += cells.bytes();
+        usage.other += (horizontal_segments.capacity() + vertical_segments.capacity()) * sizeof(Segment)
+                    +  _layout_items.capacity() * sizeof(LayoutItem);
+        usage.addScene(canvas.root, usage.scene);
     }
 
     Grid& Grid::setInternalHandleFixedSize(int fixed_size) {
@@ -483,6 +580,8 @@ namespace lluitk {
         //
         // auto style = this->
         
+        canvas_list.invalidate();
+        
         std::vector<Splitter> splitters;
         for (auto &h: horizontal_segments) {
             if (h.type == Segment::HANDLE && h.spring().isFixed() && h.spring().fixed() > 0) {
@@ -693,6 +792,16 @@ namespace lluitk {
             app.finishEventProcessing();
         }
         else if (movableSplitters()) {
+            
+            // mouse is over one of the cells: no splitter can be under it
+            if (app.current_event_info.mouse_over_widget != this) {
+                if (gesture.hover_splitter.valid()) {
+                    gesture.hover_splitter = Splitter{0,Splitter::NONE};
+                    canvas.markDirty();
+                }
+                return;
+            }
+            
             llsg::GeometricTests g;
             auto e = g.firstHit(llsg::Vec2{(double)mouse_pos.x(), (double)mouse_pos.y()}, canvas.root);
             
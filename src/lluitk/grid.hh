@@ -1,9 +1,12 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
+#include <vector>
 
 #include "simple_widget.hh"
 #include "canvas.hh"
+#include "layout_pool.hh"
+#include "render_batch.hh"
 
 #include "llsg/llsg.hh"
 #include "llsg/llsg_opengl.hh"
@@ -149,6 +152,51 @@ namespace lluitk {
         bool  _clear                  { false };
     };
     
+    //---------------------------------------------------------
+    // CellArray
+    //---------------------------------------------------------
+    
+    /*! \brief widgets of a fixed size grid, one slot per cell in GridPoint
+     * order (x major: cell p is at p.x() * size.y() + p.y())
+     *
+     * One bit per cell marks the occupied ones, so iterating a sparse grid
+     * skips 64 empty cells at a time. Lookups are direct indexing; nothing
+     * is allocated after construction.
+     */
+    struct CellArray {
+    public:
+        CellArray() = default;
+        CellArray(const GridSize& size);
+        
+        bool        inside(const GridPoint& p) const;
+        std::size_t index(const GridPoint& p) const { return (std::size_t) p.x() * _size.y() + p.y(); }
+        GridPoint   point(std::size_t index) const { return GridPoint((GridLength) (index / _size.y()), (GridLength) (index % _size.y())); }
+        
+        // throw if p is outside the grid
+        Widget*     get(const GridPoint& p) const;
+        void        set(const GridPoint& p, Widget* widget);
+        void        swap(const GridPoint& p0, const GridPoint& p1);
+        
+        Widget*     operator[](std::size_t index) const { return _cells[index]; }
+        
+        // first occupied cell at or after index (size() if none)
+        std::size_t next(std::size_t index) const;
+        
+        // one past the last occupied cell before end (0 if none)
+        std::size_t previous(std::size_t end) const;
+        
+        std::size_t size() const { return _cells.size(); }
+        std::size_t bytes() const { return _cells.capacity() * sizeof(Widget*) + _occupied.capacity() * sizeof(std::uint64_t); }
+        
+    private:
+        std::size_t checked(const GridPoint& p) const;
+        
+    private:
+        GridSize                   _size { 0, 0 };
+        std::vector<Widget*>       _cells;
+        std::vector<std::uint64_t> _occupied; // bit i % 64 of word i / 64: cell i has a widget
+    };
+    
     //----------------------------------------------------------------------------
     // WidgetContainerterator
     //----------------------------------------------------------------------------
@@ -183,49 +231,47 @@ namespace lluitk {
     
     struct Grid: public SimpleWidget {
     public:
+        // occupied cells in GridPoint order
         struct forward_iterator: public BaseWidgetIterator {
         public:
-            using it_type = decltype(std::map<GridPoint, Widget*>().cbegin());
-        public:
-            forward_iterator(it_type begin, it_type end): _current(begin), _end(end){}
+            forward_iterator(const CellArray& cells): _cells(&cells) {}
             Widget* next() {
-                if (_current != _end) {
-                    auto result = _current->second;
-                    ++_current;
-                    return result;
+                _current = _cells->next(_current);
+                if (_current < _cells->size()) {
+                    return (*_cells)[_current++];
                 }
                 else {
                     return nullptr;
                 }
             }
         public:
-            it_type _current;
-            it_type _end;
+            const CellArray* _cells;
+            std::size_t      _current { 0 };
         };
 
+        // occupied cells in reverse GridPoint order
         struct backward_iterator: public BaseWidgetIterator {
         public:
-            using it_type = decltype(std::map<GridPoint, Widget*>().crbegin());
-        public:
-            backward_iterator(it_type begin, it_type end): _current(begin), _end(end){}
+            backward_iterator(const CellArray& cells): _cells(&cells), _end(cells.size()) {}
             Widget* next() {
-                if (_current != _end) {
-                    auto result = _current->second;
-                    ++_current;
-                    return result;
+                _end = _cells->previous(_end);
+                if (_end > 0) {
+                    return (*_cells)[--_end];
                 }
                 else {
                     return nullptr;
                 }
             }
         public:
-            it_type _current;
-            it_type _end;
+            const CellArray* _cells;
+            std::size_t      _end;
         };
 
     public:
         
-        Grid() = default;
+        LLUITK_WIDGET_KIND(Grid, WIDGET_GRID)
+        
+        Grid() { _kinds |= widget_kind | WIDGET_CONTAINER | WIDGET_LAYOUT_THREAD_SAFE | WIDGET_RENDER_ON_DEMAND; }
         Grid(const GridSize& size);
         
     public: // overload the children service
@@ -237,10 +283,12 @@ namespace lluitk {
         Segment& vseg(int index);
 
         bool contains(const Point& p) const;
+        bool bounds(Window &w) const { w = window; return true; }
         
-        WidgetIterator children() const { return WidgetIterator(new forward_iterator(cell_map.cbegin(), cell_map.cend())); }
-        WidgetIterator reverse_children() const  { return  WidgetIterator(new backward_iterator(cell_map.crbegin(), cell_map.crend())); }
+        WidgetIterator children() const { return WidgetIterator::make<forward_iterator>(cells); }
+        WidgetIterator reverse_children() const  { return WidgetIterator::make<backward_iterator>(cells); }
 
+        // cells outside size throw
         void setCellWidget(const GridPoint& cell, Widget* widget);
 
         void swapWidget(const GridPoint& cell0, const GridPoint& cell1);
@@ -249,11 +297,16 @@ namespace lluitk {
         
         void render(); // assuming opengl context in pixel
                        // correct coordinates
+        void render_overlay(); // splitter handles
+        
+        bool opaque() const { return Widget::opaque() || (_grid_style.clear() && _grid_style.clear_color().alpha() >= 1.0f); }
         
         bool movableSplitters() const;
         Grid& movableSplitters(bool flag);
         
-        void pre_render();
+        bool needsRender() const { return canvas.dirty; }
+        
+        void memoryUsage(MemoryUsage &usage) const;
         
         GridStyle& grid_style();
         const GridStyle& grid_style() const;
@@ -278,12 +331,14 @@ namespace lluitk {
 
         Window window; // window of the grid...
         
-        std::map<GridPoint, Widget*> cell_map;
-    
         GridSize size { 0, 0 }; // rows and columns
         
+        CellArray cells; // widget of each cell (size is fixed)
+        
         Canvas canvas;
         
+        DisplayList canvas_list; // recording of canvas
+        
         bool _movable_splitters { true };
         
         struct {
@@ -299,6 +354,8 @@ namespace lluitk {
         std::vector<Segment> vertical_segments;
         
         GridStyle _grid_style;
+        
+        std::vector<LayoutItem> _layout_items; // reused by sizeHint
     };
     
 }
@@ -1,10 +1,12 @@
 #include "grid2.hh"
 
 #include "app.hh"
+#include "tree_stats.hh"
 
 #include "llsg/llsg_opengl.hh"
 
 #include <sstream>
+#include <unordered_map>
 
 namespace lluitk {
     
@@ -17,7 +19,8 @@ namespace lluitk {
         NodeUniquePtr::~NodeUniquePtr() {
             if (_node) { // release memory in the right way before deallocation
                 // std::cout << "deleting node: " << (void*) this << std::endl;
-                if(_node->is_slot()) { delete _node->as_slot(); }
+                if (_node->_store) { _node->_store->destroy(_node); }
+                else if(_node->is_slot()) { delete _node->as_slot(); }
                 else if(_node->is_division()) { delete _node->as_division(); }
                 else { assert(0 && "~NodeUniquePtr() not valid!"); }
             }
@@ -34,7 +37,7 @@ namespace lluitk {
             if (parent) { parent->release(_index); }
             
             // more explicit code of the wiring
-            auto division = new Division();
+            auto division = _store ? _store->division() : new Division();
             division->set(0,this); // changes _index
             
             division->type(d);
@@ -44,6 +47,28 @@ namespace lluitk {
             return division;
         }
         
+        //-----------
+        // NodeStore
+        //-----------
+        
+        Slot* NodeStore::slot() {
+            auto slot = _slots.create();
+            slot->node()->_store = this;
+            return slot;
+        }
+        
+        Division* NodeStore::division() {
+            auto division = _divisions.create();
+            division->node()->_store = this;
+            return division;
+        }
+        
+        void NodeStore::destroy(Node *node) {
+            if (node->is_slot()) { _slots.destroy(node->as_slot()); }
+            else if (node->is_division()) { _divisions.destroy(node->as_division()); }
+            else { assert(0 && "NodeStore::destroy() not valid!"); }
+        }
+        
         //----------
         // Division
         //----------
@@ -123,8 +148,11 @@ namespace lluitk {
         //-------
         
         Slot* Grid2::insert(Widget* w, int user_number, Node* at, DivisionType dt) {
-            Slot* new_slot = new Slot();
+            Slot* new_slot = _store->slot();
             new_slot->widget(w);
+            if (w) {
+                w->parent(this);
+            }
             new_slot->user_number(user_number);
             new_slot->node()->weights().variable = Vec2(1.0,1.0);
             
@@ -146,11 +174,25 @@ namespace lluitk {
             }
 
             dirty(true);
+            invalidateLayout();
+            notifyLayoutChanged(this);
             return new_slot;
         }
         
+        void Grid2::orphan(Node* node) {
+            NodeIterator it(node);
+            Node* n;
+            while ((n = it.next())) {
+                auto w = n->is_slot() ? n->as_slot()->widget() : nullptr;
+                if (w && w->parent() == this) {
+                    w->parent(nullptr);
+                }
+            }
+        }
+        
         void Grid2::remove(Node* node) {
             assert(node && _root && "Grid::remove problem!");
+            orphan(node);
             if (node == _root.get()) {
                 _root.reset(); // throu away all the data
             }
@@ -161,10 +203,13 @@ namespace lluitk {
                 node->parent()->set(node->index(), nullptr); // commit suicide... hehe
             }
             dirty(true);
+            invalidateLayout();
+            notifyLayoutChanged(this);
         }
 
         void Grid2::remove_and_simplify(Node* node) {
             assert(node && _root && "Grid::remove problem!");
+            orphan(node);
             if (node == _root.get()) { // it is the root?
             
                 _root.reset(); // clear everything
@@ -187,13 +232,17 @@ namespace lluitk {
                 if (parent_index >= 0) { // ther eis a grandparent
                     auto grandpa = parent->as_node().parent();
                     grandpa->release(parent_index);
-                    grandpa->set(parent_index, sibling); // should erase parent
+                    grandpa->set(parent_index, sibling);
+                    NodeUniquePtr erase; // parent (and node) were only released
+                    erase.reset(parent->node());
                 }
                 else {
                     _root.reset(sibling);
                 }
             }
             dirty(true);
+            invalidateLayout();
+            notifyLayoutChanged(this);
         }
 
         
@@ -233,6 +282,53 @@ namespace lluitk {
         }
 
         
+        //
+        // slots measure their widget; a division adds its two sides (and
+        // the border) along its axis and takes the larger one across it.
+        // Every node's measure is kept in measures when given
+        //
+        static Measure measure_node(Node *node, const Size &available, double border,
+                                    std::unordered_map<const Node*, Measure> *measures=nullptr) {
+            if (!node)
+                return Measure();
+            Measure m;
+            if (node->is_slot()) {
+                auto w = node->as_slot()->widget();
+                if (w)
+                    m = w->measured(available);
+            }
+            else {
+                auto division = node->as_division();
+                auto m0 = measure_node(division->get(0), available, border, measures);
+                auto m1 = measure_node(division->get(1), available, border, measures);
+                auto horizontal = division->type() == HORIZONTAL;
+                auto combine = [horizontal, border](const Size &a, const Size &b, bool upper) {
+                    auto along  = [horizontal](const Size &v) { return horizontal ? v.x() : v.y(); };
+                    auto across = [horizontal](const Size &v) { return horizontal ? v.y() : v.x(); };
+                    auto sum    = std::min(along(a) + along(b) + border, Measure().maximum.x());
+                    auto other  = upper ? std::min(across(a), across(b)) : std::max(across(a), across(b));
+                    return horizontal ? Size(sum, other) : Size(other, sum);
+                };
+                m.minimum   = combine(m0.minimum,   m1.minimum,   false);
+                m.preferred = combine(m0.preferred, m1.preferred, false);
+                m.maximum   = combine(m0.maximum,   m1.maximum,   true);
+            }
+            if (measures)
+                (*measures)[node] = m;
+            return m;
+        }
+        
+        // moves the split between the two sides of a division so that each
+        // stays within its measured minimum and maximum; when both can't,
+        // side 0 gives way
+        static void clamp_split(double &s0, double &s1, double min0, double max0, double min1, double max1) {
+            auto total = s0 + s1;
+            s0 = std::min(std::max(s0, min0), max0);
+            s1 = std::min(std::max(total - s0, min1), max1);
+            s0 = std::max(0.0, total - s1);
+            s1 = total - s0;
+        }
+        
         // compute window sizes of all slots and
         // divisions (mid-rectangle)
         void Grid2::update() {
@@ -273,7 +369,13 @@ namespace lluitk {
             
             if (_root) { update_weights(_root.get()); }
             
-            update_window = [&update_window,that](Node* node, const Window& area) {
+            auto area = Window(window.xy() + Vec2(margin_size()), window.XY() - Vec2(margin_size()));
+            
+            // weights split the area, then the measures of the slot widgets clamp it
+            std::unordered_map<const Node*, Measure> measures;
+            if (_root) { measure_node(_root.get(), Size(area.width(), area.height()), border_size(), &measures); }
+            
+            update_window = [&update_window,&measures](Node* node, const Window& area) {
                 if (!node) return;
                 node->window(area);
                 if (node->is_division()) {
@@ -291,6 +393,9 @@ namespace lluitk {
                         auto xcoef = (w - node->weights().fixed.x()) / node->weights().variable.x();
                         auto w0 = node0->weights().fixed.x() + node0->weights().variable.x() * xcoef;
                         auto w1 = node1->weights().fixed.x() + node1->weights().variable.x() * xcoef;
+                        auto &m0 = measures[node0];
+                        auto &m1 = measures[node1];
+                        clamp_split(w0, w1, m0.minimum.x(), m0.maximum.x(), m1.minimum.x(), m1.maximum.x());
                         
                         update_window (node0, Window(area.x(),            area.y(), w0,                 area.height()));
                         update_window (node1, Window(area.X() - w1,       area.y(), w1,                 area.height()));
@@ -300,6 +405,9 @@ namespace lluitk {
                         auto ycoef = (h - node->weights().fixed.y()) / node->weights().variable.y();
                         auto h0 = node0->weights().fixed.y() + node0->weights().variable.y() * ycoef;
                         auto h1 = node1->weights().fixed.y() + node1->weights().variable.y() * ycoef;
+                        auto &m0 = measures[node0];
+                        auto &m1 = measures[node1];
+                        clamp_split(h0, h1, m0.minimum.y(), m0.maximum.y(), m1.minimum.y(), m1.maximum.y());
                         
                         update_window ( node1, Window(area.x(), area.y(),            area.width(), h1                ));
                         update_window ( node0, Window(area.x(), area.Y() - h0,       area.width(), h0                ));
@@ -307,7 +415,7 @@ namespace lluitk {
                 }
             };
             
-            update_window(_root.get(),Window(window.xy() + Vec2(margin_size()), window.XY() - Vec2(margin_size())));
+            update_window(_root.get(), area);
             
             { // update hotspots
                 _scene_root.removeAll();
@@ -439,33 +547,57 @@ namespace lluitk {
             }
         }
 
-        WidgetIterator Grid2::children()         const { return WidgetIterator(new NodeWidgetIterator(const_cast<Node*>(_root.get()))); }
+        WidgetIterator Grid2::children()         const { return WidgetIterator::make<NodeWidgetIterator>(const_cast<Node*>(_root.get())); }
         
-        WidgetIterator Grid2::reverse_children() const { return WidgetIterator(new NodeWidgetIterator(const_cast<Node*>(_root.get()))); }
+        WidgetIterator Grid2::reverse_children() const { return WidgetIterator::make<NodeWidgetIterator>(const_cast<Node*>(_root.get())); }
+        
+        Measure Grid2::measure(const Size &available) {
+            auto margins = Size(2 * margin_size(), 2 * margin_size());
+            auto m = measure_node(_root.get(), available - margins, border_size());
+            m.minimum   = m.minimum   + margins;
+            m.preferred = m.preferred + margins;
+            m.maximum   = m.maximum   + margins;
+            return m;
+        }
+        
+        // a node shows if it and all its ancestors are visible
+        static bool shown(const Node *node) {
+            for (;node;node=node->parent() ? &node->parent()->_node : nullptr) {
+                if (!node->visible())
+                    return false;
+            }
+            return true;
+        }
         
         void Grid2::sizeHint(const Window &window) {
             this->window(window);
             this->update();
+            _layout_items.clear();
             NodeIterator it(_root.get());
             Node* node;
             while ((node = it.next())) {
                 if (node->is_slot() && node->as_slot()->widget()) {
                     auto w = node->window();
-                    node->as_slot()->widget()->sizeHint(Window(Vec2(std::round(w.x()), std::round(w.y())),
-                                                               Vec2(std::round(w.X()), std::round(w.Y()))));
+                    auto p = Vec2(std::round(w.x()), std::round(w.y()));
+                    // hidden slots get an empty window: nothing renders or hits there
+                    _layout_items.push_back(LayoutItem(node->as_slot()->widget(),
+                                                       shown(node) ? Window(p, Vec2(std::round(w.X()), std::round(w.Y()))) : Window(p, p)));
                 }
             }
+            lluitk::arrange(_layout_items.data(), _layout_items.size());
+            notifyLayoutChanged(this);
         }
         
-        void Grid2::render() {
-            auto it = children();
-            Widget *w;
-            // int count = 0;
-            while ((w=it.next())) {
-                // sstd::cout << count++ << std::endl;
-                w->render();
-            }
-            
+        void Grid2::memoryUsage(MemoryUsage &usage) const {
+            SimpleWidget::memoryUsage(usage);
+            usage.object = sizeof(Grid2);
+            if (auto store = _store.get())
+                usage.nodes += sizeof(NodeStore) + store->slots().arena().reserved() + store->divisions().arena().reserved();
+            usage.other += _layout_items.capacity() * sizeof(LayoutItem);
+            usage.addScene(_scene_root, usage.scene);
+        }
+        
+        void Grid2::render_overlay() {
             //
             // draw invisible handles for event detection
             //
@@ -761,7 +893,8 @@ namespace lluitk {
                 }
             };
             
-            N = [&code, &next_token, &N](NodeUniquePtr &result) {
+            auto &store = *result._store;
+            N = [&code, &next_token, &N, &store](NodeUniquePtr &result) {
                 
                 auto type = next_token();
                 
@@ -769,7 +902,7 @@ namespace lluitk {
                 
                 auto node_type = code[type.begin];
                 if (node_type == 'h' || node_type =='v') { // HORIZONTAL DIVISION
-                    result.reset((new Division())->node());
+                    result.reset(store.division()->node());
                     result->as_division()->type(node_type == 'h' ? HORIZONTAL : VERTICAL);
                     
                     NodeUniquePtr child_0, child_1;
@@ -791,7 +924,7 @@ namespace lluitk {
                     auto tok_yweight     = next_token();
                     auto tok_user_number = next_token();
                     
-                    result.reset((new Slot())->node());
+                    result.reset(store.slot()->node());
                     
                     try {
                         auto xweight = std::stof(std::string(&code[tok_xweight.begin],&code[tok_xweight.end]));
@@ -822,15 +955,25 @@ namespace lluitk {
         //--------------
         
         Node* NodeIterator::next() {
-            if (!_stack.size()) return nullptr;
-            auto top = _stack.back();
-            _stack.pop_back();
-            if (top->is_slot()) { return top; }
-            else {
-                _stack.push_back(top->as_division()->get(1));
-                _stack.push_back(top->as_division()->get(0));
-                return top;
+            auto result = _current;
+            if (!result) return nullptr;
+            
+            // pre-order successor following the parent/index links
+            auto node = result;
+            if (node->is_division()) {
+                _current = node->as_division()->get(0);
+                return result;
+            }
+            while (node != _root && node->parent()) {
+                auto parent = node->parent();
+                if (node->index() == 0) {
+                    _current = parent->get(1);
+                    return result;
+                }
+                node = parent->node();
             }
+            _current = nullptr;
+            return result;
         }
         
         //--------------------
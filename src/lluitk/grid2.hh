@@ -2,8 +2,10 @@
 
 #include <cassert>
 
+#include "arena.hh"
 #include "simple_widget.hh"
 #include "canvas.hh"
+#include "layout_pool.hh"
 
 #include "llsg/llsg.hh"
 #include "llsg/llsg_opengl.hh"
@@ -17,6 +19,7 @@ namespace lluitk {
         struct Node;
         struct Slot;
         struct Division;
+        struct NodeStore;
         
         //
         // Avoiding inheritance: explicit encoding of a inheritance simulation
@@ -91,6 +94,8 @@ namespace lluitk {
             Weights   _weights;            // slot weights are user defined, Division weights are computed
 
             NodeType  _node_type;
+            
+            NodeStore* _store { nullptr };  // where the node was allocated (nullptr: the heap)
 
         public:
 
@@ -190,14 +195,66 @@ namespace lluitk {
             
         };
         
+        //-----------
+        // NodeStore
+        //-----------
+        
+        //
+        // Slots and divisions of one Grid2, allocated contiguously from two
+        // pools. Removed nodes go back to their pool and everything is
+        // released in a few large blocks when the grid goes away.
+        //
+        struct NodeStore {
+        public:
+            NodeStore() = default;
+            
+            NodeStore(const NodeStore& other) = delete;
+            NodeStore& operator=(const NodeStore& other) = delete;
+            
+            Slot*     slot();
+            Division* division();
+            void      destroy(Node *node);
+            
+            const Pool<Slot>&     slots() const { return _slots; }
+            const Pool<Division>& divisions() const { return _divisions; }
+            
+        private:
+            Pool<Slot>     _slots;
+            Pool<Division> _divisions;
+        };
+        
+        //
+        // owns the NodeStore of a grid. Moves swap (like NodeUniquePtr), so
+        // a grid's nodes and the store they live in always travel together
+        //
+        struct NodeStorePtr {
+        public:
+            NodeStorePtr() = default;
+            ~NodeStorePtr() { delete _store; }
+            
+            NodeStorePtr(const NodeStorePtr& other) = delete;
+            NodeStorePtr& operator=(const NodeStorePtr& other) = delete;
+            
+            NodeStorePtr(NodeStorePtr&& other) { std::swap(_store, other._store); }
+            NodeStorePtr& operator=(NodeStorePtr&& other) { std::swap(_store, other._store); return *this; }
+            
+            NodeStore& operator*() { if (!_store) _store = new NodeStore(); return *_store; }
+            NodeStore* operator->() { return &**this; }
+            const NodeStore* get() const { return _store; }
+            
+        private:
+            NodeStore* _store { nullptr };
+        };
+        
         //-------
         // Grid2
         //-------
         
         struct Grid2: public lluitk::SimpleWidget {
         public:
+            NodeStorePtr  _store; // before _root: outlives the nodes
             NodeUniquePtr _root; // has to delete node on destruction
-            bool _dirty; // one some node becomes visible/invisible or some
+            bool _dirty { true }; // one some node becomes visible/invisible or some
 
             // weight grows, there should be a recalculation of
             // the slot sizes
@@ -214,33 +271,44 @@ namespace lluitk {
             Division*   _resizing_division { nullptr };
             Vec2        _resizing_weight_per_pixel;
             
+            std::vector<LayoutItem> _layout_items; // reused by sizeHint
+            
         public:
-            Grid2() { _scene_root.style().color().reset({1.0f}); }
+            LLUITK_WIDGET_KIND(Grid2, WIDGET_GRID2)
+            
+            Grid2() { _kinds |= widget_kind | WIDGET_CONTAINER | WIDGET_LAYOUT_THREAD_SAFE | WIDGET_RENDER_ON_DEMAND; _scene_root.style().color().reset({1.0f}); }
             
             bool dirty() const { return _dirty; }
             void dirty(bool flag) { _dirty = flag; }
             
+            bool needsRender() const { return _dirty; }
+            
+            void memoryUsage(MemoryUsage &usage) const;
+            
             Node* root() { return _root.get(); }
             const Node* root() const { return _root.get(); }
 
             int border_size() const { return _border_size; }
             int margin_size() const { return _margin_size; }
 
-            void border_size(int b) { _border_size = b; dirty(true); }
-            void margin_size(int m) { _margin_size = m; dirty(true); }
+            void border_size(int b) { _border_size = b; dirty(true); invalidateLayout(); }
+            void margin_size(int m) { _margin_size = m; dirty(true); invalidateLayout(); }
 
             // return the slot
             Slot* insert(Widget *widget, int user_number=-1, Node* at=nullptr, DivisionType dt=HORIZONTAL);
             void remove(Node* node);
 
             void remove_and_simplify(Node* node);
+            
+            // clears the parent of the widgets below node (before removing it)
+            void orphan(Node* node);
 
             void window(const Window& w) { _window=w; dirty(true); }
             const Window& window() const { return _window; }
             
-            void render();
+            void render_overlay();
             
-            void swap_widgets(Slot *s1, Slot *s2) { auto aux = s1->widget(); s1->widget(s2->widget()); s2->widget(aux); }
+            void swap_widgets(Slot *s1, Slot *s2) { auto aux = s1->widget(); s1->widget(s2->widget()); s2->widget(aux); invalidateLayout(); notifyLayoutChanged(this); }
             
             // compute window sizes of all slots
             void update();
@@ -277,11 +345,14 @@ namespace lluitk {
         public:
             
             bool contains(const Point& p) const { return _window.contains(p); }
+            bool bounds(Window &w) const { w = _window; return true; }
             
             WidgetIterator children() const;
             WidgetIterator reverse_children() const;
             
             void sizeHint(const Window &window);
+            
+            Measure measure(const Size &available);
 
         };
 
@@ -289,11 +360,17 @@ namespace lluitk {
         // NodeIterator
         //--------------
         
+        //
+        // pre-order walk of the subtree at n. Uses the parent/index links
+        // of the nodes instead of a stack, so it never allocates; the tree
+        // must not change while iterating.
+        //
         struct NodeIterator {
             NodeIterator() = default;
-            NodeIterator(Node *n) { if (n) _stack.push_back(n); }
+            NodeIterator(Node *n): _root(n), _current(n) {}
             Node* next();
-            std::vector<Node*> _stack;
+            Node* _root    { nullptr };
+            Node* _current { nullptr };
         };
 
         
@@ -0,0 +1,270 @@
+#include "hit_index.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // HitIndex
+    //------------------------------------------------------------------------------
+
+    static const int MAX_GRID_SIDE = 64;
+
+    HitIndex::HitIndex() {
+        addLayoutObserver(this);
+    }
+
+    HitIndex::~HitIndex() {
+        removeLayoutObserver(this);
+    }
+
+    void HitIndex::reset(Widget *root) {
+        _root = root;
+        _full_rebuild = true;
+        _changed.clear();
+        ++_version;
+    }
+
+    void HitIndex::layoutChanged(Widget *widget) {
+        if (_full_rebuild) {
+            ++_version;
+            return;
+        }
+        // unknown widgets belong to some other tree (e.g. another window's
+        // app) or are below an opaque entry: their own indexed ancestors
+        // notify us if it matters
+        if (_lookup.find(widget) == _lookup.end())
+            return;
+        ++_version;
+        // too many pending changes: cheaper to start from scratch
+        if (_changed.size() >= _entries.size()) {
+            _full_rebuild = true;
+            _changed.clear();
+            return;
+        }
+        _changed.push_back(widget);
+    }
+
+    int HitIndex::collect(Widget *widget, int parent) {
+        auto first = (int) _entries.size();
+        
+        // entries are appended in pre-order; _parents holds the entry
+        // indices of the open ancestors
+        _parents.clear();
+        _parents.push_back(parent);
+        _walker.walk(widget,
+                     [this](Widget *w) {
+                         auto index = (int) _entries.size();
+                         _entries.push_back(Entry(w, _parents.back()));
+                         _lookup[w] = index;
+                         
+                         Window bounds;
+                         if (!w->bounds(bounds)) {
+                             _entries[index].opaque = true;
+                             _entries[index].end    = index + 1;
+                             return WALK_SKIP;
+                         }
+                         _entries[index].bounds = bounds;
+                         _parents.push_back(index);
+                         return WALK_CONTINUE;
+                     },
+                     [this](Widget *w) {
+                         _entries[_parents.back()].end = (int) _entries.size();
+                         _parents.pop_back();
+                     });
+        return first;
+    }
+
+    void HitIndex::rebuild() {
+        _entries.clear();
+        _lookup.clear();
+        _cells.clear();
+        _columns = 0;
+        _rows    = 0;
+
+        if (!_root)
+            return;
+
+        collect(_root, -1);
+
+        auto &root = _entries.front();
+        if (root.opaque)
+            return; // nothing to index: routing is linear from the root
+
+        // roughly one entry per cell
+        auto side = (int) std::ceil(std::sqrt((double) _entries.size()));
+        side = std::max(1, std::min(MAX_GRID_SIDE, side));
+
+        _area      = root.bounds;
+        _columns   = side;
+        _rows      = side;
+        _cell_size = Vec2(std::max(_area.width(), 1.0)  / _columns,
+                          std::max(_area.height(), 1.0) / _rows);
+        _cells.assign(_columns * _rows, std::vector<int>());
+
+        for (auto i=0;i<(int)_entries.size();++i) {
+            insertIntoCells(i);
+        }
+    }
+
+    bool HitIndex::refreshSubtree(int index) {
+        auto old_root = _entries[index];
+        auto begin    = index;
+        auto end      = old_root.end;
+
+        // collect the subtree again at the end of the entry list
+        auto old_size = (int) _entries.size();
+        collect(old_root.widget, old_root.parent);
+        auto new_count = (int) _entries.size() - old_size;
+
+        // structure changed (or the grid geometry): rebuild everything
+        if (new_count != end - begin || (index == 0 && _entries[old_size].bounds != _area)) {
+            return false;
+        }
+
+        for (auto i=begin;i<end;++i) {
+            removeFromCells(i);
+        }
+
+        auto offset = old_size - begin;
+        for (auto i=begin;i<end;++i) {
+            auto e = _entries[i + offset];
+            e.end = e.end - offset;
+            if (e.parent >= old_size) {
+                e.parent -= offset;
+            }
+            _entries[i] = e;
+            _lookup[e.widget] = i;
+            insertIntoCells(i);
+        }
+        _entries.resize(old_size);
+
+        return true;
+    }
+
+    void HitIndex::refresh() {
+        if (_full_rebuild) {
+            rebuild();
+            _full_rebuild = false;
+            _changed.clear();
+            return;
+        }
+
+        if (_changed.empty())
+            return;
+
+        // recorded widgets may have left the tree since
+        std::vector<int> indices;
+        indices.reserve(_changed.size());
+        for (auto w: _changed) {
+            auto it = _lookup.find(w);
+            if (it != _lookup.end()) {
+                indices.push_back(it->second);
+            }
+        }
+        _changed.clear();
+
+        std::sort(indices.begin(), indices.end());
+
+        auto covered_end = -1;
+        for (auto i: indices) {
+            if (i < covered_end)
+                continue; // an ancestor was already refreshed
+            if (!refreshSubtree(i)) {
+                rebuild();
+                return;
+            }
+            covered_end = _entries[i].end;
+        }
+    }
+
+    bool HitIndex::cellRange(const Window& w, int &x0, int &y0, int &x1, int &y1) const {
+        if (!_columns || w.X() < _area.x() || w.x() > _area.X() || w.Y() < _area.y() || w.y() > _area.Y())
+            return false;
+        auto clamp = [](int v, int n) { return std::max(0, std::min(n-1, v)); };
+        x0 = clamp((int) std::floor((w.x() - _area.x()) / _cell_size.x()), _columns);
+        x1 = clamp((int) std::floor((w.X() - _area.x()) / _cell_size.x()), _columns);
+        y0 = clamp((int) std::floor((w.y() - _area.y()) / _cell_size.y()), _rows);
+        y1 = clamp((int) std::floor((w.Y() - _area.y()) / _cell_size.y()), _rows);
+        return true;
+    }
+
+    void HitIndex::insertIntoCells(int index) {
+        auto &e = _entries[index];
+        // an opaque widget could be hit anywhere inside its parent
+        auto &w = (e.opaque && e.parent >= 0) ? _entries[e.parent].bounds : e.bounds;
+        int x0, y0, x1, y1;
+        if (!cellRange(w, x0, y0, x1, y1))
+            return;
+        for (auto y=y0;y<=y1;++y) {
+            for (auto x=x0;x<=x1;++x) {
+                auto &cell = _cells[y * _columns + x];
+                cell.insert(std::lower_bound(cell.begin(), cell.end(), index), index);
+            }
+        }
+    }
+
+    void HitIndex::removeFromCells(int index) {
+        auto &e = _entries[index];
+        auto &w = (e.opaque && e.parent >= 0) ? _entries[e.parent].bounds : e.bounds;
+        int x0, y0, x1, y1;
+        if (!cellRange(w, x0, y0, x1, y1))
+            return;
+        for (auto y=y0;y<=y1;++y) {
+            for (auto x=x0;x<=x1;++x) {
+                auto &cell = _cells[y * _columns + x];
+                auto it = std::lower_bound(cell.begin(), cell.end(), index);
+                if (it != cell.end() && *it == index) {
+                    cell.erase(it);
+                }
+            }
+        }
+    }
+
+    bool HitIndex::path(const Point& p, Widget *from, std::vector<Widget*> &path) {
+        refresh();
+
+        path.push_back(from);
+
+        auto it = _lookup.find(from);
+        if (it == _lookup.end())
+            return false;
+
+        auto current = it->second;
+        if (_entries[current].opaque)
+            return false;
+
+        if (!_columns || !_area.contains(p))
+            return true; // no indexed widget other than from can contain p
+
+        auto clamp = [](int v, int n) { return std::max(0, std::min(n-1, v)); };
+        auto cx = clamp((int) std::floor((p.x() - _area.x()) / _cell_size.x()), _columns);
+        auto cy = clamp((int) std::floor((p.y() - _area.y()) / _cell_size.y()), _rows);
+        auto &cell = _cells[cy * _columns + cx];
+
+        //
+        // entries are in pre-order, so the first child of current found
+        // in the cell that contains p is the one with highest priority;
+        // descendants of current come right after it
+        //
+        for (auto i=std::upper_bound(cell.begin(), cell.end(), current);i!=cell.end();++i) {
+            auto index = *i;
+            if (index >= _entries[current].end)
+                break;
+            auto &e = _entries[index];
+            if (e.parent != current)
+                continue;
+            if (!e.opaque && !e.bounds.contains(p))
+                continue;
+            if (!e.widget->contains(p))
+                continue;
+            current = index;
+            path.push_back(e.widget);
+            if (e.opaque)
+                return false;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "geom.hh"
+#include "widget.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // HitIndex
+    //------------------------------------------------------------------------------
+
+    /*! \brief uniform grid over the windows of a widget tree
+     *
+     * Widgets are stored in pre-order, visiting children in the order given by
+     * reverse_children(). A smaller entry index therefore means higher event
+     * priority among siblings, and a subtree occupies a contiguous range of
+     * entries. Each grid cell keeps the (sorted) indices of the entries whose
+     * bounds overlap it, so resolving the event path of a point only looks at
+     * the widgets of a single cell.
+     *
+     * Widgets that don't report bounds() are kept as opaque entries: their
+     * subtree is not indexed and the caller has to continue routing linearly
+     * from them.
+     *
+     * The index listens to notifyLayoutChanged() and lazily refreshes only the
+     * subtrees that were laid out again.
+     */
+    struct HitIndex: public LayoutObserver {
+    public:
+
+        struct Entry {
+        public:
+            Entry() = default;
+            Entry(Widget *widget, int parent): widget(widget), parent(parent) {}
+        public:
+            Widget* widget { nullptr };
+            Window  bounds;
+            int     parent { -1 };    // entry index of the parent widget
+            int     end    { 0 };     // one past the last entry of the subtree
+            bool    opaque { false }; // no bounds: subtree is not indexed
+        };
+
+    public:
+        HitIndex();
+        ~HitIndex();
+
+        HitIndex(const HitIndex& other) = delete;
+        HitIndex& operator=(const HitIndex& other) = delete;
+
+        void reset(Widget *root);
+
+        void layoutChanged(Widget *widget);
+
+        // incremented whenever the indexed geometry might have changed
+        std::size_t version() const { return _version; }
+
+        //
+        // appends to path the widgets an event at p should visit, starting at
+        // (and including) from and going down the tree. Returns true if the
+        // path is complete, false if routing has to continue linearly from
+        // path.back() (unknown or opaque widget).
+        //
+        bool path(const Point& p, Widget *from, std::vector<Widget*> &path);
+
+        std::size_t size() const { return _entries.size(); }
+
+    private:
+        void refresh();
+        void rebuild();
+        bool refreshSubtree(int index);
+        int  collect(Widget *widget, int parent);
+
+        bool cellRange(const Window& w, int &x0, int &y0, int &x1, int &y1) const;
+        void insertIntoCells(int index);
+        void removeFromCells(int index);
+
+    private:
+        Widget*                          _root { nullptr };
+        std::vector<Entry>               _entries;
+        std::unordered_map<Widget*, int> _lookup;
+        std::vector<Widget*>             _changed;
+        WidgetWalker                     _walker { true }; // reverse_children() order
+        std::vector<int>                 _parents; // collect() scratch
+        bool                             _full_rebuild { true };
+        std::size_t                      _version { 0 };
+
+        // uniform grid
+        Window                           _area;
+        int                              _columns { 0 };
+        int                              _rows { 0 };
+        Vec2                             _cell_size;
+        std::vector<std::vector<int>>    _cells;
+    };
+
+}
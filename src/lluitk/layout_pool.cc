@@ -0,0 +1,190 @@
+#include "layout_pool.hh"
+
+#include <algorithm>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // LayoutPool
+    //------------------------------------------------------------------------------
+
+    // queue of the pool worker running on this thread (none: outside thread)
+    static thread_local const void* _worker_pool  = nullptr;
+    static thread_local std::size_t _worker_queue = 0;
+
+    LayoutPool::LayoutPool(std::size_t threads) {
+        if (!threads) {
+            auto hardware = std::thread::hardware_concurrency();
+            threads = hardware > 1 ? hardware - 1 : 1;
+        }
+        for (std::size_t i=0;i<=threads;++i) {
+            _queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        }
+        for (std::size_t i=0;i<threads;++i) {
+            _workers.push_back(std::thread(&LayoutPool::work, this, i));
+        }
+    }
+
+    LayoutPool::~LayoutPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _done = true;
+        }
+        _wakeup.notify_all();
+        for (auto &t: _workers) {
+            t.join();
+        }
+    }
+
+    void LayoutPool::run(std::size_t n, const Task &task) {
+        if (n == 0)
+            return;
+        if (n == 1 || _workers.empty()) {
+            for (std::size_t i=0;i<n;++i) {
+                task(i);
+            }
+            return;
+        }
+
+        auto queue = (_worker_pool == this) ? _worker_queue : _workers.size();
+
+        std::atomic<std::size_t> pending { n };
+        {
+            auto &q = *_queues[queue];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            // in reverse: the owner pops from the back, so it starts with job 0
+            for (auto i=n;i>0;--i) {
+                q.jobs.push_back(Job { &task, i - 1, &pending });
+            }
+        }
+        _queued.fetch_add(n);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+        }
+        _wakeup.notify_all();
+
+        // help until the batch is done
+        Job job;
+        while (pending.load(std::memory_order_acquire)) {
+            if (next(queue, job))
+                execute(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void LayoutPool::work(std::size_t index) {
+        _worker_pool  = this;
+        _worker_queue = index;
+        Job job;
+        while (true) {
+            if (next(index, job)) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeup.wait(lock, [this]() { return _done || _queued.load() > 0; });
+            if (_done)
+                return;
+        }
+    }
+
+    bool LayoutPool::next(std::size_t queue, Job &job) {
+        if (!_queued.load())
+            return false;
+        {
+            auto &q = *_queues[queue];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.jobs.empty()) {
+                job = q.jobs.back();
+                q.jobs.pop_back();
+                _queued.fetch_sub(1);
+                return true;
+            }
+        }
+        for (std::size_t i=1;i<_queues.size();++i) {
+            auto &q = *_queues[(queue + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.jobs.empty()) {
+                job = q.jobs.front();
+                q.jobs.pop_front();
+                _queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void LayoutPool::execute(const Job &job) {
+        (*job.task)(job.index);
+        job.pending->fetch_sub(1, std::memory_order_release);
+    }
+
+    //------------------------------------------------------------------------------
+    // Parallel arrange
+    //------------------------------------------------------------------------------
+
+    static LayoutPool* _layout_pool        = nullptr;
+    static std::size_t _layout_cost_threshold = 32;
+
+    LayoutPool* layoutPool() {
+        return _layout_pool;
+    }
+
+    void layoutPool(LayoutPool *pool) {
+        _layout_pool = pool;
+    }
+
+    std::size_t layoutCostThreshold() {
+        return _layout_cost_threshold;
+    }
+
+    void layoutCostThreshold(std::size_t widgets) {
+        _layout_cost_threshold = widgets;
+    }
+
+    void arrange(const LayoutItem *items, std::size_t count) {
+        auto pool = _layout_pool;
+
+        // which siblings go to the pool (not the ones arrange() would skip)
+        std::vector<std::size_t> parallel;
+        if (pool && pool->size() && count > 1) {
+            for (std::size_t i=0;i<count;++i) {
+                auto w = items[i].widget;
+                if (w && w->needsArrange(items[i].window) && w->layoutCost() >= _layout_cost_threshold)
+                    parallel.push_back(i);
+            }
+        }
+        if (parallel.size() < 2) {
+            for (std::size_t i=0;i<count;++i) {
+                if (items[i].widget)
+                    items[i].widget->arrange(items[i].window);
+            }
+            return;
+        }
+
+        // notifications of each parallel item, replayed below in item order
+        std::vector<std::vector<Widget*>> notifications(parallel.size());
+        pool->run(parallel.size(), [&](std::size_t k) {
+            auto &item     = items[parallel[k]];
+            auto previous  = deferLayoutNotifications(&notifications[k]);
+            item.widget->arrange(item.window);
+            deferLayoutNotifications(previous);
+        });
+
+        // the serial items and the replay, in the original order
+        std::size_t k = 0;
+        for (std::size_t i=0;i<count;++i) {
+            if (k < parallel.size() && parallel[k] == i) {
+                for (auto w: notifications[k]) {
+                    notifyLayoutChanged(w);
+                }
+                ++k;
+            }
+            else if (items[i].widget) {
+                items[i].widget->arrange(items[i].window);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "geom.hh"
+#include "widget.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // LayoutPool
+    //------------------------------------------------------------------------------
+
+    /*! \brief small work-stealing thread pool for parallel layout
+     *
+     * Each worker owns a deque: it pushes and pops its own jobs at the back
+     * and steals from the front of the others' when it runs out. run() fans
+     * out a batch and doesn't return before all of it is done; the calling
+     * thread executes jobs while it waits, so nested run() calls (a
+     * container laid out on a worker fanning out its own children) can't
+     * deadlock.
+     */
+    struct LayoutPool {
+    public:
+        using Task = std::function<void(std::size_t)>;
+
+    public:
+        LayoutPool(std::size_t threads=0); // 0: one less than the hardware threads
+        ~LayoutPool();
+
+        LayoutPool(const LayoutPool& other) = delete;
+        LayoutPool& operator=(const LayoutPool& other) = delete;
+
+        std::size_t size() const { return _workers.size(); }
+
+        // task(0) ... task(n-1), possibly in parallel
+        void run(std::size_t n, const Task &task);
+
+    private:
+        struct Job {
+            const Task*               task;
+            std::size_t               index;
+            std::atomic<std::size_t>* pending;
+        };
+
+        struct Queue {
+            std::mutex      mutex;
+            std::deque<Job> jobs;
+        };
+
+        void work(std::size_t index);
+        bool next(std::size_t queue, Job &job); // own back first, then steal
+        void execute(const Job &job);
+
+    private:
+        std::vector<std::unique_ptr<Queue>> _queues; // one per worker plus one for outside threads
+        std::vector<std::thread>             _workers;
+        std::mutex                           _mutex;
+        std::condition_variable              _wakeup;
+        std::atomic<std::size_t>             _queued { 0 };
+        bool                                 _done { false };
+    };
+
+    //------------------------------------------------------------------------------
+    // Parallel arrange
+    //------------------------------------------------------------------------------
+
+    struct LayoutItem {
+        LayoutItem() = default;
+        LayoutItem(Widget *widget, const Window &window): widget(widget), window(window) {}
+        Widget* widget { nullptr };
+        Window  window;
+    };
+
+    //
+    // Arranges each item's widget to its window, the way a container does
+    // once it has computed its children's windows. Serial unless a pool is
+    // installed (App::parallelLayout); then siblings that need arranging
+    // and whose Widget::layoutCost() is at least layoutCostThreshold() are
+    // arranged on the pool. notifyLayoutChanged calls made on the pool
+    // are deferred and replayed on the calling thread in serial order, so
+    // the outcome is the same as the serial layout.
+    //
+    void arrange(const LayoutItem *items, std::size_t count);
+
+    LayoutPool* layoutPool();
+    void        layoutPool(LayoutPool *pool); // nullptr: serial layout
+
+    std::size_t layoutCostThreshold();
+    void        layoutCostThreshold(std::size_t widgets);
+
+}
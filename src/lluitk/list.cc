@@ -24,11 +24,11 @@ namespace lluitk {
         //----------------
         
         SpeedupWheel::SpeedupWheel() {
-            _starttime = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            _starttime = clock().now();
         }
         
         double SpeedupWheel::speedup(llsg::Vec2 move) {
-            auto current_ts = std::chrono::high_resolution_clock::now().time_since_epoch().count();;
+            auto current_ts = clock().now();
             
             // wheelos() << (current_ts - _starttime) << "|" << move.y() << "|" << RENDER_LOOP_ITERATON << std::endl;
             
@@ -40,7 +40,7 @@ namespace lluitk {
             }
             else {
                 auto dt = current_ts - _ts;
-                if (dt < 1000000000ULL) { // 25ms
+                if (dt < 1000000ULL) { // 1s
                     if ((_repeats % 1) == 0) {
                         //if (_factor < 128) {
                         _factor += 1;
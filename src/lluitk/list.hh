@@ -5,7 +5,9 @@
 #include "base.hh"
 #include "event.hh"
 #include "app.hh"
+#include "render_batch.hh"
 #include "simple_widget.hh"
+#include "tree_stats.hh"
 
 #include "llsg/llsg.hh"
 #include "llsg/llsg_opengl.hh"
@@ -128,9 +130,15 @@ namespace lluitk {
             
             ListConfig               _config;
             bool                     _dirty { true };
+            bool                     _scrolled { false }; // only the position changed
             
             llsg::Group              _root;
             llsg::Group              _scroller_root;
+            lluitk::DisplayList      _root_list;
+            lluitk::DisplayList      _scroller_list;
+            int                      _prepared_i0 { -1 }; // items in _root
+            int                      _prepared_i1 { -1 };
+            int                      _model_size { -1 };  // last size seen (sizeHint, pre_render)
             
             Microseconds             _last_press_timestamp { 0 };
             bool                     _dragging { false };
@@ -140,9 +148,9 @@ namespace lluitk {
 
         public:
 
-            List() = default;
+            List() { _kinds |= WIDGET_LIST | WIDGET_LAYOUT_THREAD_SAFE | WIDGET_RENDER_ON_DEMAND; } // no widget_kind: List<A> and List<B> share the bit
             
-            void model(Model *model) { _model=model; dirty(true); }
+            void model(Model *model) { _model=model; dirty(true); invalidateLayout(); }
             
             void  generate_geometry_callback(GenerateGeometryCallback ggc) { _generate_geometry_callback = ggc; dirty(true);}
 
@@ -157,6 +165,15 @@ namespace lluitk {
             bool dirty() const { return _dirty; }
             
             void dirty(bool d) { _dirty = d; }
+            
+            bool needsRender() const { return _dirty || _scrolled || model_resized(); }
+            
+            void memoryUsage(lluitk::MemoryUsage &usage) const {
+                SimpleWidget::memoryUsage(usage);
+                usage.object = sizeof(List);
+                usage.addScene(_root, usage.geometry);
+                usage.addScene(_scroller_root, usage.scene);
+            }
         
         public:
             void onMouseWheel(const lluitk::App &app);
@@ -166,18 +183,31 @@ namespace lluitk {
 
         public:
             
+            void pre_render();
             void render();
             void prepare();
             
+            // translation only update after a scroll; false if other items
+            // became visible and prepare() is needed
+            bool scroll();
+            
             bool contains(const lluitk::Point& p) const { return _config.window().contains(p); }
+            bool bounds(lluitk::Window &w) const { w = _config.window(); return true; }
             void sizeHint(const lluitk::Window &window);
             
-            llsg::Group& root() { return _root; }
+            // preferred length: all items (pre_render invalidates the layout when the model size changes)
+            lluitk::Measure measure(const lluitk::Size &available) {
+                lluitk::Measure m;
+                m.preferred = lluitk::Size(available.x(), _model ? _model->size() * _config.item_weight() : 0.0);
+                return m;
+            }
+            
+            llsg::Group& root() { return _root; } // call dirty(true) after changing it
 
             ListConfig&  config() { return _config; }
             const ListConfig&  config() const { return _config; }
             
-            void item_weight(float w) { _config.item_weight(w); _dirty = true; }
+            void item_weight(float w) { _config.item_weight(w); _dirty = true; invalidateLayout(); }
 
             llsg::Color scrollbar_bar_color() const { return _scrollbar_bar_color; }
             llsg::Color scrollbar_cursor_color() const { return _scrollbar_cursor_color; }
@@ -189,6 +219,11 @@ namespace lluitk {
             
             void _trigger() { if (_trigger_callback) _trigger_callback(*this); }
             
+            bool model_resized() const { return _model && _model->size() != _model_size; }
+            
+            void visible_range(int &i0, int &i1) const;
+            void prepare_scroller();
+            
         };
         
         //---------------------------------------------------------------------------
@@ -206,7 +241,8 @@ namespace lluitk {
             _config.window(window);
 
             auto offset = -_config.position().y();
-            auto length = _model->size() * _config.item_weight();
+            _model_size = _model->size();
+            auto length = _model_size * _config.item_weight();
             auto max_offset = std::max(0.0,static_cast<double>((length - _config.window().height())));
             _config.position().y(-std::min(std::max(0.0, offset),max_offset));
 
@@ -236,7 +272,7 @@ namespace lluitk {
                 auto max_offset = static_cast<double>((_model->size() * _config.item_weight() - _config.window().height()));
                 _config.position().y(-std::min(std::max(0.0,candidate_offset),max_offset));
                 
-                _dirty    = true;
+                _scrolled = true;
                 _dragging = true;
                 app.lock(this);
             }
@@ -266,7 +302,7 @@ namespace lluitk {
                 auto max_offset = static_cast<double>((_model->size() * _config.item_weight() - _config.window().height()));
                 _config.position().y(-std::min(std::max(0.0,candidate_offset),max_offset));
                 
-                _dirty = true;
+                _scrolled = true;
             }
         }
 
@@ -278,6 +314,17 @@ namespace lluitk {
             }
         }
         
+        template <typename M>
+        void List<M>::pre_render() {
+            // the model doesn't notify: a new size changes the measure and
+            // the scroll range, so lay out again (App does it next frame)
+            if (model_resized()) {
+                _model_size = _model->size();
+                _dirty = true;
+                invalidateLayout();
+            }
+        }
+        
         template <typename M>
         void List<M>::render() {
             auto& window = _config.window();
@@ -285,13 +332,55 @@ namespace lluitk {
             if (window.width() == 0 || window.height() == 0)
                 return;
 
-            if (_dirty)
+            if (_dirty || (_scrolled && !scroll()))
                 prepare();
             
             // get llsg renderer and
             // _scene.img().key(resloc::getResourcePath("logo/nanocubes-blue-name-logo.png")).coords(llsg::Quad{0.0f,0.0f,600.0f,180.0f});
-            llsg::opengl::getRenderer().render(_root, llsg::Transform{}.translate(window.min()), window, false);
-            llsg::opengl::getRenderer().render(_scroller_root, llsg::Transform{}.translate(window.min()), window, false);
+            auto &position = _config.position();
+            auto transform = llsg::Transform{}.translate(window.min());
+            lluitk::submitRender(_root, transform, window, false, &_root_list, llsg::Vec2(-position.x(), -position.y()));
+            lluitk::submitRender(_scroller_root, transform, window, false, &_scroller_list);
+        }
+        
+        template <typename M>
+        bool List<M>::scroll() {
+            if (!_model || _model->size() == 0)
+                return false;
+            int i0, i1;
+            visible_range(i0, i1);
+            if (i0 != _prepared_i0 || i1 != _prepared_i1)
+                return false;
+            
+            // same items: move them (a recorded _root_list is replayed
+            // under the new translation)
+            auto &position = _config.position();
+            _root.identity().translate({-position.x(),-position.y()});
+            prepare_scroller();
+            _scrolled = false;
+            return true;
+        }
+        
+        template <typename M>
+        void List<M>::visible_range(int &i0, int &i1) const {
+            auto &window   = _config.window();
+            auto &position = _config.position();
+            auto  vertical = _config.vertical();
+            
+            //
+            // given the current position,
+            // figure out item range that is visible
+            //
+            i0 = (int) ( (vertical ? -position.y() : position.x()) / _config.item_weight());
+            i1 = (int) ((vertical ?
+                                    window.height() - position.y() :
+                                    window.width()  + position.x()) / _config.item_weight());
+            if (i1 >= _model->size()) {
+                i1 = (int) (_model->size()) - 1;
+            }
+            if (i0 > i1) {
+                i0 = i1;
+            }
         }
         
         template <typename M>
@@ -320,7 +409,7 @@ namespace lluitk {
                 if (_config.position().y() > 0) {
                     _config.position().y(0);
                 }
-                _dirty = true;
+                _scrolled = true;
             }
             
         }
@@ -334,6 +423,8 @@ namespace lluitk {
               
             //
             _root.removeAll();
+            _root_list.invalidate();
+            _prepared_i0 = _prepared_i1 = -1;
             
             
             
@@ -347,22 +438,10 @@ namespace lluitk {
             if (!_model || _model->size() == 0)
                 return;
         
-            // regenerate all the geometry from scratch (improve this later)
-        
-            //
-            // given the current position,
-            // figure out item range that is visible
-            //
-            auto i0 = (int) ( (vertical ? -position.y() : position.x()) / _config.item_weight());
-            auto i1 = (int) ((vertical ?
-                                           window.height() - position.y() :
-                                           window.width()  + position.x()) / _config.item_weight());
-            if (i1 >= _model->size()) {
-                i1 = (int) (_model->size()) - 1;
-            }
-            if (i0 > i1) {
-                i0 = i1;
-            }
+            // regenerate all the geometry from scratch (scroll() avoids
+            // it while the same items stay visible)
+            int i0, i1;
+            visible_range(i0, i1);
         
 
             { // prepare geometry of items
@@ -380,10 +459,27 @@ namespace lluitk {
                     g.append(std::move(elem_p));
                 }
                 _root.identity().translate({-position.x(),-position.y()});
+                _prepared_i0 = i0;
+                _prepared_i1 = i1;
             }
+            
+            prepare_scroller();
+        
+            _dirty    = false;
+            _scrolled = false;
+
+        } // _prepare
         
+        template <typename M>
+        void List<M>::prepare_scroller() {
+            
+            auto &window   = _config.window();
+            auto &position = _config.position();
+            auto  vertical = _config.vertical();
+            
             { // prepare scroller (draw two rectangles if needed)
                 _scroller_root.removeAll();
+                _scroller_list.invalidate();
                 
                 //
                 // length == n * w
@@ -434,10 +530,7 @@ namespace lluitk {
                         .style().color().reset(llsg::Color{1.0f,1.0f,1.0f,1.0f});
                 }
             }
-        
-            _dirty = false;
-
-        } // _prepare
+        }
         
     } // list
     
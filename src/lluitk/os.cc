@@ -1,5 +1,6 @@
 #include "os.hh"
 
+#include <atomic>
 #include <iostream>
 #include <string>
 
@@ -81,9 +82,16 @@ namespace lluitk {
         }
 
         
+        void Window::make_current() {
+            auto window = static_cast<GLFWwindow*>(handle);
+            if (glfwGetCurrentContext() != window)
+                glfwMakeContextCurrent(window);
+        }
+        
         void Window::swap_buffers() {
             auto window = static_cast<GLFWwindow*>(handle);
             glfwSwapBuffers(window);
+            last_swap = event::monotonicNow();
         }
         
         //------------------------------------------------------------------------------
@@ -95,6 +103,10 @@ namespace lluitk {
             std::cerr << "error: " << std::string(description) << std::endl;
         }
         
+        // glfwPostEmptyEvent may be called from any thread, but only once
+        // glfw is initialized (headless apps never initialize it)
+        static std::atomic<bool> glfw_initialized { false };
+        
         GraphicsLayer::GraphicsLayer() {
             // initialize glfw
             glfwSetErrorCallback(error_callback);
@@ -103,6 +115,7 @@ namespace lluitk {
             if (!ok) {
                 throw std::runtime_error("oops");
             }
+            glfw_initialized = true;
             
             glfwWindowHint(GLFW_SAMPLES, 2);
             glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
@@ -123,12 +136,15 @@ namespace lluitk {
             for (auto &i: _windows) {
                 i.reset();
             }
+            glfw_initialized = false;
             glfwTerminate();
         }
         
         Window& GraphicsLayer::window(int width, int height, bool visible, bool decorated, Window *parent) {
             _windows.push_back(std::unique_ptr<Window>(new Window(width, height, visible, decorated, parent)));
             auto &window = *_windows.back().get();
+            window.index = (int) _windows.size() - 1;
+            _handles[window.handle] = &window;
             
             
             if (visible) { // interaction between graphics layer and event layer
@@ -147,11 +163,10 @@ namespace lluitk {
         }
         
         Window& GraphicsLayer::window(WindowHandle handle) const {
-            for (auto &i: _windows) {
-                if (i.get()->handle == handle)
-                    return *i.get();
-            }
-            throw std::runtime_error("no glcontext with given window");
+            auto it = _handles.find(handle);
+            if (it == _handles.end())
+                throw std::runtime_error("no glcontext with given window");
+            return *it->second;
         }
         
         /*!
@@ -191,14 +206,63 @@ namespace lluitk {
             return *this;
         }
         
-        EventLayer& EventLayer::trigger(const event::Event &e) {
-            if (_callback)
+        EventLayer& EventLayer::callback(const Window& window, EventCallbackType cb) {
+            if ((int) _window_callbacks.size() <= window.index)
+                _window_callbacks.resize(window.index + 1);
+            _window_callbacks[window.index] = cb;
+            return *this;
+        }
+        
+        void EventLayer::deliver(const event::EventRecord &e) const {
+            auto index = e.window();
+            if (index < (int) _window_callbacks.size() && _window_callbacks[index])
+                _window_callbacks[index](e);
+            else if (_callback)
                 _callback(e);
+        }
+        
+        EventLayer& EventLayer::trigger(const event::EventRecord &e) {
+            if (_coalesce)
+                _queue.push(e);
+            else
+                deliver(e);
+            return *this;
+        }
+        
+        EventLayer& EventLayer::trigger(const event::Event &e) {
+            return trigger(event::makeRecord(e));
+        }
+        
+        EventLayer& EventLayer::coalesce(bool flag) {
+            if (!flag)
+                flush();
+            _coalesce = flag;
+            return *this;
+        }
+        
+        EventLayer& EventLayer::flush() {
+            _queue.drain([this](const event::EventRecord &e) { deliver(e); });
             return *this;
         }
         
         EventLayer& EventLayer::poll() {
             glfwPollEvents();
+            flush();
+            return *this;
+        }
+        
+        EventLayer& EventLayer::wait(double timeout) {
+            if (timeout < 0.0)
+                glfwWaitEvents();
+            else
+                glfwWaitEventsTimeout(timeout);
+            flush();
+            return *this;
+        }
+        
+        EventLayer& EventLayer::wake() {
+            if (glfw_initialized)
+                glfwPostEmptyEvent();
             return *this;
         }
         
@@ -224,6 +288,7 @@ namespace lluitk {
         
         void window_size_callback(GLFWwindow* glfwwindow, int width, int height)
         {
+            auto t = event::monotonicNow(); // input time, before any queueing
             auto &window = graphics().window(handle(glfwwindow));
             
             //            int actual_width, actual_height;
@@ -235,13 +300,14 @@ namespace lluitk {
             window.framebuffer_width  = width  * window.window_to_framebuffer_factor;
             window.framebuffer_height = height * window.window_to_framebuffer_factor;
             
-            event().trigger( event::WindowResize { { (double) window.framebuffer_width, (double) window.framebuffer_height } });
+            event().trigger(event::EventRecord::windowResize({ (double) window.framebuffer_width, (double) window.framebuffer_height }).stamp(t).window(window.index));
 
         }
         
         void key_callback(GLFWwindow* glfwwindow, int key, int scancode, int action, int mods)
         {
-            // auto &window = graphics().window(handle(glfwwindow));
+            auto t = event::monotonicNow();
+            auto &window = graphics().window(handle(glfwwindow));
             
             // don't bother with repeat
             if (action == GLFW_REPEAT)
@@ -256,10 +322,10 @@ namespace lluitk {
             auto key_code = (event::KeyCode) key;
             
             if (action == GLFW_PRESS) {
-                event().trigger(event::KeyPress { key_code, modifiers });
+                event().trigger(event::EventRecord::keyPress(key_code, modifiers).stamp(t).window(window.index));
             }
             else {
-                event().trigger(event::KeyRelease { key_code, modifiers });
+                event().trigger(event::EventRecord::keyRelease(key_code, modifiers).stamp(t).window(window.index));
             }
             //
             //        auto e_type = action == GLFW_PRESS ? event::EVENT_KEY_PRESS : event::EVENT_KEY_RELEASE;
@@ -279,6 +345,7 @@ namespace lluitk {
         }
         
         void cursor_callback(GLFWwindow *glfwwindow, double x, double y) {
+            auto t = event::monotonicNow();
 
 //            std::cerr << "cursor_callback: " << x << ", " << y << std::endl;
 //            std::cerr.flush();
@@ -305,12 +372,13 @@ namespace lluitk {
             
             // std::cerr << p.x() << "," << p.y() << std::endl;
             
-            event().trigger(event::MouseMove { p });
+            event().trigger(event::EventRecord::mouseMove(p).stamp(t).window(window.index));
         }
         
         void wheel_callback(GLFWwindow *glfwwindow, double x, double y) {
+            auto t = event::monotonicNow();
             
-            // auto &window = graphics().window(handle(glfwwindow));
+            auto &window = graphics().window(handle(glfwwindow));
             
             //        double xx, yy;
             //        glfwGetCursorPos(glfwwindow, &xx, &yy);
@@ -328,7 +396,7 @@ namespace lluitk {
                 (y > 0 ? 1.0 : (y < 0 ? -1.0 : 0.0)) };
             ;
             
-            event().trigger(event::MouseWheel { delta, modifiers });
+            event().trigger(event::EventRecord::mouseWheel(delta, modifiers).stamp(t).window(window.index));
             // event::WheelEvent e(event::WHEEL_EVENT, modifiers, pos, delta);
             // main_instance.signal_wheel.trigger(opengl_context, e);
             
@@ -336,8 +404,9 @@ namespace lluitk {
         
         
         void mouse_button_callback(GLFWwindow *glfwwindow, int button, int action, int mods) {
+            auto t = event::monotonicNow();
             
-            // auto &window = graphics().window(handle(glfwwindow));
+            auto &window = graphics().window(handle(glfwwindow));
 
             event::Modifiers modifiers(GLFW_MOD_SHIFT   & mods,
                                        GLFW_MOD_CONTROL & mods,
@@ -349,10 +418,10 @@ namespace lluitk {
                                         event::MOUSE_BUTTON_MIDDLE);
 
             if (action == GLFW_PRESS) {
-                event().trigger(event::MousePress { btn, modifiers });
+                event().trigger(event::EventRecord::mousePress(btn, modifiers).stamp(t).window(window.index));
             }
             else {
-                event().trigger(event::MouseRelease { btn, modifiers });
+                event().trigger(event::EventRecord::mouseRelease(btn, modifiers).stamp(t).window(window.index));
             }
 //
 //            auto e_type = (action == GLFW_PRESS) ? event::MOUSE_PRESS_EVENT : event::;
@@ -381,6 +450,10 @@ namespace lluitk {
             return std::string(glfwGetClipboardString((GLFWwindow*)g.window().handle));
         }
         
+        WindowHandle currentContext() {
+            return handle(glfwGetCurrentContext());
+        }
+        
     } // namespace os
     
 } // namespace lluitk
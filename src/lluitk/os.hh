@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <unordered_map>
 
 #include "geom.hh"
 #include "event.hh"
@@ -28,6 +29,7 @@ namespace os {
         ~Window();
         
         void bind_to_thread();
+        void make_current(); // cheap: no-op if the context is already current
         void swap_buffers();
         bool done();
         
@@ -46,6 +48,8 @@ namespace os {
         int framebuffer_height           { 0 };
         int window_to_framebuffer_factor { 1 }; // one window pixel == two framebuffer pixels on retina displays
         int requested_height             { 0 };
+        event::Timestamp last_swap       { 0 }; // monotonic time the last swap_buffers returned
+        int index                        { 0 }; // creation order (stamped on its events)
     };
 
     //--------------------------------------------------------------------------
@@ -68,15 +72,18 @@ namespace os {
         Window& window(int index=0) const;
     public:
         friend GraphicsLayer& graphics();
+        
+        int count() const { return (int) _windows.size(); }
     private:
-        std::vector<std::unique_ptr<Window>> _windows;
+        std::vector<std::unique_ptr<Window>>    _windows;
+        std::unordered_map<WindowHandle, Window*> _handles; // called on every glfw callback
     };
 
     //--------------------------------------------------------------------------
     // EventsCallbackType
     //--------------------------------------------------------------------------
     
-    using EventCallbackType = std::function<void(const ::lluitk::event::Event&)>;
+    using EventCallbackType = std::function<void(const ::lluitk::event::EventRecord&)>;
     
     //--------------------------------------------------------------------------
     // EventsLayer
@@ -88,10 +95,32 @@ namespace os {
         EventLayer& registerWindowCallbacks(const Window& window);
     public:
         EventLayer& poll();
+        
+        // blocks until some event arrives or timeout (in seconds) expires
+        // (a negative timeout waits forever), then delivers events like poll
+        EventLayer& wait(double timeout=-1.0);
+        
+        // makes a pending (or the next) wait return; safe from any thread
+        EventLayer& wake();
         EventLayer& callback(EventCallbackType cb);
+        
+        // events of window go to cb instead of the default callback
+        EventLayer& callback(const Window& window, EventCallbackType cb);
+        EventLayer& trigger(const event::EventRecord &e);
         EventLayer& trigger(const event::Event &e);
+        
+        // when coalescing, trigger only buffers the event and the callback
+        // sees the (merged) events once per poll, in order
+        EventLayer& coalesce(bool flag);
+        bool        coalesce() const { return _coalesce; }
+        EventLayer& flush();
+    private:
+        void deliver(const event::EventRecord &e) const;
     private:
         EventCallbackType _callback;
+        std::vector<EventCallbackType> _window_callbacks; // by window index
+        event::EventQueue _queue;
+        bool              _coalesce { false };
     };
     
     //--------------------------------------------------------------------------
@@ -104,6 +133,9 @@ namespace os {
     
     std::string clipboard();
     
+    // window whose GL context is current on the calling thread (nullptr: none)
+    WindowHandle currentContext();
+    
     
     
     
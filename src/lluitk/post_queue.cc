@@ -0,0 +1,62 @@
+#include "post_queue.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // PostQueue
+    //------------------------------------------------------------------------------
+
+    PostQueue::PostQueue():
+    _head(&_stub),
+    _tail(&_stub)
+    {}
+
+    PostQueue::~PostQueue() {
+        Task task;
+        while (pop(task)) {}
+    }
+
+    void PostQueue::pushNode(Node *node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        auto prev = _head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    void PostQueue::push(Task task) {
+        auto node = new Node();
+        node->task = std::move(task);
+        _size.fetch_add(1, std::memory_order_relaxed);
+        pushNode(node);
+    }
+
+    bool PostQueue::pop(Task &task) {
+        auto tail = _tail;
+        auto next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &_stub) {
+            if (!next)
+                return false;
+            _tail = next;
+            tail  = next;
+            next  = next->next.load(std::memory_order_acquire);
+        }
+
+        if (!next) {
+            // tail is the last node: unless a producer is half way through
+            // a push, put the stub back behind it so tail can be released
+            if (tail != _head.load(std::memory_order_acquire))
+                return false;
+            pushNode(&_stub);
+            next = tail->next.load(std::memory_order_acquire);
+            if (!next)
+                return false;
+        }
+
+        _tail = next;
+        task  = std::move(tail->task);
+        delete tail;
+        _size.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // PostQueue
+    //------------------------------------------------------------------------------
+
+    /*! \brief lock-free multi-producer single-consumer queue of tasks
+     *
+     * Intrusive linked list with a stub node (D. Vyukov's MPSC queue): push
+     * is one allocation, one atomic exchange and one store, from any thread,
+     * and never waits for the consumer or other producers. pop must be called
+     * from a single (the ui) thread. A push that is still in progress may be
+     * invisible to pop for a moment: the producer wakes the consumer after
+     * pushing, so nothing is lost.
+     */
+    struct PostQueue {
+    public:
+        using Task = std::function<void()>;
+
+        struct Node {
+            Node() = default;
+            std::atomic<Node*> next { nullptr };
+            Task               task;
+        };
+
+    public:
+        PostQueue();
+        ~PostQueue();
+
+        PostQueue(const PostQueue& other) = delete;
+        PostQueue& operator=(const PostQueue& other) = delete;
+
+        void push(Task task); // any thread
+
+        bool pop(Task &task); // consumer thread only
+
+        // approximate number of queued tasks
+        std::size_t size() const { return _size.load(std::memory_order_relaxed); }
+
+    private:
+        void pushNode(Node *node);
+
+    private:
+        std::atomic<Node*>       _head;
+        Node*                    _tail;
+        Node                     _stub;
+        std::atomic<std::size_t> _size { 0 };
+    };
+
+}
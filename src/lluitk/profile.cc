@@ -0,0 +1,214 @@
+#include "profile.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <typeinfo>
+
+#ifdef __GNUG__
+#include <cstdlib>
+#include <cxxabi.h>
+#endif
+
+#include "widget.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // ProfilePhase
+    //------------------------------------------------------------------------------
+
+    const char* profilePhaseName(ProfilePhase phase) {
+        static const char* names[PROFILE_PHASES] = {
+            "mouse_move",
+            "mouse_wheel",
+            "mouse_press",
+            "mouse_release",
+            "mouse_enter",
+            "mouse_leave",
+            "key_press",
+            "key_release",
+            "pre_render",
+            "render"
+        };
+        return (phase >= 0 && phase < PROFILE_PHASES) ? names[phase] : "unknown";
+    }
+
+    ProfilePhase profilePhase(event::EventType type) {
+        switch (type) {
+            case event::EVENT_MOUSE_MOVE:    return PROFILE_MOUSE_MOVE;
+            case event::EVENT_MOUSE_WHEEL:   return PROFILE_MOUSE_WHEEL;
+            case event::EVENT_MOUSE_PRESS:   return PROFILE_MOUSE_PRESS;
+            case event::EVENT_MOUSE_RELEASE: return PROFILE_MOUSE_RELEASE;
+            case event::EVENT_KEY_PRESS:     return PROFILE_KEY_PRESS;
+            case event::EVENT_KEY_RELEASE:   return PROFILE_KEY_RELEASE;
+            default:                         return PROFILE_PHASES;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // LatencyHistogram
+    //------------------------------------------------------------------------------
+
+    void LatencyHistogram::add(Nanoseconds t) {
+        // number of significant bits (shifting by 64 would be undefined)
+        auto bucket = 0;
+        while (bucket < BUCKETS - 1 && (t >> bucket)) {
+            ++bucket;
+        }
+        ++buckets[bucket];
+        ++count;
+        total += t;
+        max    = std::max(max, t);
+    }
+
+    Nanoseconds LatencyHistogram::percentile(double q) const {
+        if (!count)
+            return 0;
+        auto rank = (std::uint64_t) std::max(1.0, q * count + 0.5);
+        std::uint64_t acc = 0;
+        for (auto i=0;i<BUCKETS;++i) {
+            acc += buckets[i];
+            if (acc >= rank) {
+                auto upper = (i == 0) ? Nanoseconds(0) : (i >= 64 ? max : (Nanoseconds(1) << i) - 1);
+                return std::min(upper, max);
+            }
+        }
+        return max;
+    }
+
+    LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& other) {
+        for (auto i=0;i<BUCKETS;++i) {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        total += other.total;
+        max    = std::max(max, other.max);
+        return *this;
+    }
+
+    //------------------------------------------------------------------------------
+    // ProfileStats
+    //------------------------------------------------------------------------------
+
+    ProfileStats& ProfileStats::operator+=(const ProfileStats& other) {
+        for (auto i=0;i<PROFILE_PHASES;++i) {
+            phases[i] += other.phases[i];
+        }
+        return *this;
+    }
+
+    //------------------------------------------------------------------------------
+    // Profiler
+    //------------------------------------------------------------------------------
+
+    static std::string type_name(const Widget *widget) {
+        auto name = typeid(*widget).name();
+#ifdef __GNUG__
+        int status = 0;
+        auto demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+        if (status == 0 && demangled) {
+            std::string result(demangled);
+            std::free(demangled);
+            return result;
+        }
+#endif
+        return name;
+    }
+
+    static Profiler* _current_profiler = nullptr;
+
+    Profiler* Profiler::current() {
+        return _current_profiler;
+    }
+
+    void Profiler::current(Profiler *profiler) {
+        _current_profiler = profiler;
+    }
+
+    void Profiler::record(const Widget *widget, ProfilePhase phase, Nanoseconds t) {
+        if (!widget || phase < 0 || phase >= PROFILE_PHASES)
+            return;
+        auto it = _widgets.find(widget);
+        if (it == _widgets.end()) {
+            it = _widgets.insert(std::make_pair(widget, WidgetEntry())).first;
+            it->second.type = type_name(widget);
+        }
+        it->second.stats.phases[phase].add(t);
+    }
+
+    const ProfileStats* Profiler::widget(const Widget *widget) const {
+        auto it = _widgets.find(widget);
+        return it == _widgets.end() ? nullptr : &it->second.stats;
+    }
+
+    std::map<std::string, ProfileStats> Profiler::types() const {
+        std::map<std::string, ProfileStats> result;
+        for (auto &it: _widgets) {
+            result[it.second.type] += it.second.stats;
+        }
+        return result;
+    }
+
+    void Profiler::clear() {
+        _widgets.clear();
+    }
+
+    static void dump_stats(std::ostream &os, const std::string &name, const ProfileStats &stats) {
+        for (auto i=0;i<PROFILE_PHASES;++i) {
+            auto &h = stats.phases[i];
+            if (!h.count)
+                continue;
+            os << std::left  << std::setw(40) << name
+               << std::setw(14) << profilePhaseName((ProfilePhase) i)
+               << std::right
+               << std::setw(10) << h.count
+               << std::setw(12) << h.mean() / 1000.0
+               << std::setw(12) << h.percentile(0.50) / 1000.0
+               << std::setw(12) << h.percentile(0.99) / 1000.0
+               << std::setw(12) << h.max / 1000.0
+               << std::endl;
+        }
+    }
+
+    void Profiler::dump(std::ostream &os) const {
+        auto header = [&os](const char *title) {
+            os << std::left  << std::setw(40) << title
+               << std::setw(14) << "phase"
+               << std::right
+               << std::setw(10) << "count"
+               << std::setw(12) << "mean_us"
+               << std::setw(12) << "p50_us"
+               << std::setw(12) << "p99_us"
+               << std::setw(12) << "max_us"
+               << std::endl;
+        };
+
+        header("type");
+        for (auto &it: types()) {
+            dump_stats(os, it.first, it.second);
+        }
+
+        os << std::endl;
+        header("widget");
+        for (auto &it: _widgets) {
+            std::stringstream ss;
+            ss << it.second.type << "@" << it.first;
+            dump_stats(os, ss.str(), it.second.stats);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // ProfileScope
+    //------------------------------------------------------------------------------
+
+    ProfileScope::~ProfileScope() {
+        auto profiler = Profiler::current();
+        if (!profiler)
+            return;
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+        profiler->record(_widget, _phase, (Nanoseconds) elapsed);
+    }
+
+}
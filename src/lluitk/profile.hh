@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "event.hh"
+
+//------------------------------------------------------------------------------
+// Instrumentation is compiled in only when LLUITK_PROFILE is defined (cmake
+// option LLUITK_PROFILE). Otherwise the scope macros expand to nothing and
+// App carries no profiler.
+//------------------------------------------------------------------------------
+
+#ifdef LLUITK_PROFILE
+#define LLUITK_PROFILE_SCOPE(widget, phase) ::lluitk::ProfileScope lluitk_profile_scope_(widget, phase)
+#define LLUITK_PROFILE_BIND(profiler)       ::lluitk::ProfileBinding lluitk_profile_binding_(profiler)
+#else
+#define LLUITK_PROFILE_SCOPE(widget, phase)
+#define LLUITK_PROFILE_BIND(profiler)
+#endif
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // Forward Decl.
+    //------------------------------------------------------------------------------
+
+    struct Widget;
+
+    using Nanoseconds = std::uint64_t;
+
+    //------------------------------------------------------------------------------
+    // ProfilePhase
+    //------------------------------------------------------------------------------
+
+    enum ProfilePhase {
+        PROFILE_MOUSE_MOVE,
+        PROFILE_MOUSE_WHEEL,
+        PROFILE_MOUSE_PRESS,
+        PROFILE_MOUSE_RELEASE,
+        PROFILE_MOUSE_ENTER,
+        PROFILE_MOUSE_LEAVE,
+        PROFILE_KEY_PRESS,
+        PROFILE_KEY_RELEASE,
+        PROFILE_PRE_RENDER,
+        PROFILE_RENDER,
+        PROFILE_PHASES // number of phases
+    };
+
+    const char*  profilePhaseName(ProfilePhase phase);
+    ProfilePhase profilePhase(event::EventType type);
+
+    //------------------------------------------------------------------------------
+    // LatencyHistogram
+    //------------------------------------------------------------------------------
+
+    /*! \brief log2 buckets of nanoseconds
+     *
+     * Bucket 0 counts zero latencies and bucket i > 0 counts latencies in
+     * [2^(i-1), 2^i). Percentiles are reported as the upper bound of the
+     * bucket they fall in (clamped by the maximum), so they are accurate
+     * within a factor of two.
+     */
+    struct LatencyHistogram {
+    public:
+        static const int BUCKETS = 65;
+    public:
+        LatencyHistogram() = default;
+
+        void add(Nanoseconds t);
+
+        Nanoseconds percentile(double q) const; // q in [0,1]
+        Nanoseconds mean() const { return count ? total / count : 0; }
+
+        LatencyHistogram& operator+=(const LatencyHistogram& other);
+
+    public:
+        std::uint64_t count   { 0 };
+        Nanoseconds   total   { 0 };
+        Nanoseconds   max     { 0 };
+        std::uint64_t buckets[BUCKETS] { };
+    };
+
+    //------------------------------------------------------------------------------
+    // ProfileStats
+    //------------------------------------------------------------------------------
+
+    struct ProfileStats {
+    public:
+        ProfileStats& operator+=(const ProfileStats& other);
+
+        const LatencyHistogram& operator[](ProfilePhase phase) const { return phases[phase]; }
+
+    public:
+        LatencyHistogram phases[PROFILE_PHASES];
+    };
+
+    //------------------------------------------------------------------------------
+    // Profiler
+    //------------------------------------------------------------------------------
+
+    /*! \brief call counts and latency histograms of event handlers and render
+     * calls, per widget instance and per widget type
+     *
+     * Event handler latencies are inclusive (a handler may forward the event
+     * to other widgets); render calls are made by App one widget at a time,
+     * so a container's render time doesn't include its children's. The
+     * llsg draws a widget submits are issued right away and count in its
+     * render time. Widgets are only used as keys (their type name is taken
+     * on the first record), so stats may outlive them.
+     */
+    struct Profiler {
+    public:
+        struct WidgetEntry {
+            std::string  type;
+            ProfileStats stats;
+        };
+
+    public:
+        Profiler() = default;
+
+        void record(const Widget *widget, ProfilePhase phase, Nanoseconds t);
+
+        // nullptr if the widget was never recorded
+        const ProfileStats* widget(const Widget *widget) const;
+
+        // aggregated over all recorded instances of each type
+        std::map<std::string, ProfileStats> types() const;
+
+        const std::unordered_map<const Widget*, WidgetEntry>& widgets() const { return _widgets; }
+
+        void clear();
+
+        // one line per (type or widget, phase): count mean p50 p99 max (in us)
+        void dump(std::ostream &os) const;
+
+        // profiler that scopes record into (may be null)
+        static Profiler* current();
+        static void      current(Profiler *profiler);
+
+    private:
+        std::unordered_map<const Widget*, WidgetEntry> _widgets;
+    };
+
+    //------------------------------------------------------------------------------
+    // ProfileScope
+    //------------------------------------------------------------------------------
+
+    struct ProfileScope {
+    public:
+        ProfileScope(const Widget *widget, ProfilePhase phase):
+        _widget(widget), _phase(phase), _start(std::chrono::steady_clock::now())
+        {}
+        ~ProfileScope();
+
+        ProfileScope(const ProfileScope& other) = delete;
+        ProfileScope& operator=(const ProfileScope& other) = delete;
+
+    private:
+        const Widget*                         _widget;
+        ProfilePhase                          _phase;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    //------------------------------------------------------------------------------
+    // ProfileBinding
+    //------------------------------------------------------------------------------
+
+    // makes profiler current while in scope (restores the previous one)
+    struct ProfileBinding {
+    public:
+        ProfileBinding(Profiler &profiler): _previous(Profiler::current()) { Profiler::current(&profiler); }
+        ~ProfileBinding() { Profiler::current(_previous); }
+
+        ProfileBinding(const ProfileBinding& other) = delete;
+        ProfileBinding& operator=(const ProfileBinding& other) = delete;
+
+    private:
+        Profiler *_previous;
+    };
+
+}
@@ -0,0 +1,167 @@
+#include "render_batch.hh"
+
+#include "llsg/llsg_opengl.hh"
+
+#include <algorithm>
+
+#include <GL/glew.h>
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // DisplayList
+    //------------------------------------------------------------------------------
+
+    void DisplayList::release() {
+        if (!_list)
+            return;
+        if (auto context = _context.lock())
+            context->garbage.push_back(_list);
+        _list     = 0;
+        _recorded = false;
+        _context.reset();
+    }
+
+    //------------------------------------------------------------------------------
+    // RenderBatch
+    //------------------------------------------------------------------------------
+
+    void RenderBatch::draw(const llsg::Group &root, const llsg::Transform &transform, const Window &clip, bool flag,
+                           DisplayList *cache, const Vec2 &offset) {
+        ++_stats.submissions;
+        render(Item { &root, transform, cache, offset, clip, flag });
+    }
+
+    void RenderBatch::clear(const llsg::Color &color, const Window &window) {
+        ++_stats.submissions;
+        ++_stats.draw_calls;
+        auto &renderer = llsg::opengl::getRenderer();
+        renderer.clear_color(color);
+        renderer.clear(window);
+    }
+
+    void RenderBatch::context(const void *context) {
+        if (!_current || _current->context != context) {
+            auto it = std::find_if(_contexts.begin(), _contexts.end(), [context](const std::shared_ptr<DisplayListContext> &c) {
+                return c->context == context;
+            });
+            if (it == _contexts.end()) {
+                _contexts.push_back(std::make_shared<DisplayListContext>());
+                _contexts.back()->context = context;
+                it = _contexts.end() - 1;
+            }
+            _current = *it;
+        }
+        collect();
+    }
+
+    void RenderBatch::collect() {
+        if (!_current)
+            return;
+        for (auto list: _current->garbage) {
+            glDeleteLists(list, 1);
+        }
+        _current->garbage.clear();
+    }
+
+    void RenderBatch::render(const Item &item) {
+        auto &renderer = llsg::opengl::getRenderer();
+        auto  cache    = item.cache;
+        if (!cache || !_display_lists || cache->_failed) {
+            ++_stats.draw_calls;
+            renderer.render(*item.root, item.transform, item.clip, item.flag);
+            return;
+        }
+
+        if (!_current)
+            context(nullptr); // no context given: the one current now
+        
+        if (cache->_list && cache->_context.lock() != _current)
+            cache->release(); // recorded in another context
+
+        if (cache->_recorded) {
+            auto dx = item.offset.x() - cache->_offset.x();
+            auto dy = item.offset.y() - cache->_offset.y();
+            if (dx != 0.0 || dy != 0.0) {
+                glMatrixMode(GL_MODELVIEW);
+                glPushMatrix();
+                glTranslated(dx, dy, 0.0);
+                glCallList(cache->_list);
+                glPopMatrix();
+            }
+            else {
+                glCallList(cache->_list);
+            }
+            ++_stats.replayed;
+            return;
+        }
+
+        ++_stats.draw_calls;
+
+        // first submission of this content: let the renderer settle
+        if (!cache->_stable) {
+            cache->_stable = true;
+            renderer.render(*item.root, item.transform, item.clip, item.flag);
+            return;
+        }
+
+        if (!cache->_list) {
+            cache->_list    = glGenLists(1);
+            cache->_context = _current;
+        }
+        if (!cache->_list) {
+            cache->_failed = true;
+            renderer.render(*item.root, item.transform, item.clip, item.flag);
+            return;
+        }
+
+        for (auto i=0;i<8 && glGetError() != GL_NO_ERROR;++i) {} // clear older errors
+        glNewList(cache->_list, GL_COMPILE_AND_EXECUTE);
+        renderer.render(*item.root, item.transform, item.clip, item.flag);
+        glEndList();
+        if (glGetError() != GL_NO_ERROR) {
+            glDeleteLists(cache->_list, 1);
+            cache->_list   = 0;
+            cache->_context.reset();
+            cache->_failed = true;
+            return;
+        }
+        cache->_offset   = item.offset;
+        cache->_recorded = true;
+        ++_stats.recorded;
+    }
+
+    //------------------------------------------------------------------------------
+    // Submission
+    //------------------------------------------------------------------------------
+
+    static RenderBatch* _render_batch = nullptr;
+
+    RenderBatch* renderBatch() {
+        return _render_batch;
+    }
+
+    void renderBatch(RenderBatch *batch) {
+        _render_batch = batch;
+    }
+
+    void submitRender(const llsg::Group &root, const llsg::Transform &transform, const Window &clip, bool flag,
+                      DisplayList *cache, const Vec2 &offset) {
+        if (_render_batch) {
+            _render_batch->draw(root, transform, clip, flag, cache, offset);
+            return;
+        }
+        llsg::opengl::getRenderer().render(root, transform, clip, flag);
+    }
+
+    void submitClear(const llsg::Color &color, const Window &window) {
+        if (_render_batch) {
+            _render_batch->clear(color, window);
+            return;
+        }
+        auto &renderer = llsg::opengl::getRenderer();
+        renderer.clear_color(color);
+        renderer.clear(window);
+    }
+
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "geom.hh"
+
+#include "llsg/llsg.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // RenderStats
+    //------------------------------------------------------------------------------
+
+    struct RenderStats {
+    public:
+        void reset() { *this = RenderStats(); }
+
+    public:
+        std::size_t submissions   { 0 }; // submitRender/submitClear calls
+        std::size_t draw_calls    { 0 }; // renderer render/clear calls issued
+        std::size_t replayed      { 0 }; // display lists called instead of rendering
+        std::size_t recorded      { 0 }; // display lists (re)compiled
+    };
+
+    //------------------------------------------------------------------------------
+    // DisplayListContext
+    //------------------------------------------------------------------------------
+
+    //
+    // GL contexts are not shared, so a display list can only be called or
+    // deleted while the context it was created in is current. A DisplayList
+    // that goes away queues its list here; the RenderBatch rendering in that
+    // context deletes it the next time it gets there
+    //
+    struct DisplayListContext {
+    public:
+        const void*           context { nullptr }; // os::WindowHandle
+        std::vector<unsigned> garbage;             // lists to delete
+    };
+
+    //------------------------------------------------------------------------------
+    // DisplayList
+    //------------------------------------------------------------------------------
+
+    /*! \brief retained GL recording of what a widget submits
+     *
+     * A widget that owns one passes it to submitRender and calls
+     * invalidate() whenever it rebuilds the submitted group. Once the same
+     * content is submitted a second time (so lazily created renderer
+     * resources, e.g. glyph textures, already exist), the renderer output
+     * is compiled into a display list; later frames call the list instead
+     * of traversing the group. The offset passed along with it is the
+     * group's translation: when only that changes (scrolling), the list is
+     * replayed under the difference instead of being recorded again.
+     *
+     * If the list can't be created or compiling it raises a GL error, the
+     * widget keeps rendering directly. Copies start empty.
+     *
+     * The list belongs to the context it was recorded in: submitted in
+     * another context it is recorded again, and when it goes away it is
+     * deleted by the RenderBatch of its context (never in whatever context
+     * happens to be current). Lists whose RenderBatch is already gone are
+     * left to their context.
+     */
+    struct DisplayList {
+    public:
+        DisplayList() = default;
+        DisplayList(const DisplayList& other) {}
+        DisplayList& operator=(const DisplayList& other) { invalidate(); return *this; }
+        ~DisplayList() { release(); }
+
+        // the submitted group changed
+        void invalidate() { _recorded = false; _stable = false; }
+
+        bool recorded() const { return _recorded; }
+
+    private:
+        friend struct RenderBatch;
+
+        void release(); // queues _list for deletion in its context
+
+        std::weak_ptr<DisplayListContext> _context; // where _list was created
+        unsigned _list     { 0 };
+        Vec2     _offset;               // translation at recording time
+        bool     _recorded { false };
+        bool     _stable   { false };   // submitted once since the last invalidate
+        bool     _failed   { false };   // GL refused to record it: render directly
+    };
+
+    //------------------------------------------------------------------------------
+    // RenderBatch
+    //------------------------------------------------------------------------------
+
+    /*! \brief what the llsg submissions of a render pass go through
+     *
+     * While a batch is installed (App does it for its render passes),
+     * submitRender and submitClear go through it: they are issued right
+     * away (so widgets that still call the llsg renderer directly stay in
+     * painter's order with everyone else), replaying or recording display
+     * lists and counting RenderStats on the way.
+     */
+    struct RenderBatch {
+    public:
+        RenderBatch() = default;
+
+        RenderBatch(const RenderBatch& other) = delete;
+        RenderBatch& operator=(const RenderBatch& other) = delete;
+
+        void draw(const llsg::Group &root, const llsg::Transform &transform, const Window &clip, bool flag,
+                  DisplayList *cache=nullptr, const Vec2 &offset=Vec2());
+        void clear(const llsg::Color &color, const Window &window);
+
+        // end of the pass: deletes the lists released while rendering
+        void flush() { collect(); }
+
+        // the GL context (os::WindowHandle) the next flush renders into,
+        // current from now on: deletes the lists released in it so far
+        void context(const void *context);
+
+        // use the DisplayList of the submissions that have one (default on)
+        void displayLists(bool flag) { _display_lists = flag; }
+        bool displayLists() const { return _display_lists; }
+
+        RenderStats&       stats()       { return _stats; }
+        const RenderStats& stats() const { return _stats; }
+
+    private:
+        struct Item {
+            const llsg::Group* root;
+            llsg::Transform    transform;
+            DisplayList*       cache;
+            Vec2               offset;
+            Window             clip;
+            bool               flag;
+        };
+
+        void render(const Item &item);
+        void collect(); // deletes the lists released in the current context
+
+    private:
+        RenderStats              _stats;
+        bool                     _display_lists { true };
+
+        std::vector<std::shared_ptr<DisplayListContext>> _contexts; // contexts rendered into
+        std::shared_ptr<DisplayListContext>              _current;
+    };
+
+    //------------------------------------------------------------------------------
+    // Submission
+    //------------------------------------------------------------------------------
+
+    // the batch submissions go to (nullptr: they render immediately)
+    RenderBatch* renderBatch();
+    void         renderBatch(RenderBatch *batch);
+
+    // what widgets call from render() instead of using the llsg renderer directly
+    void submitRender(const llsg::Group &root, const llsg::Transform &transform, const Window &clip, bool flag=true,
+                      DisplayList *cache=nullptr, const Vec2 &offset=Vec2());
+    void submitClear(const llsg::Color &color, const Window &window);
+
+}
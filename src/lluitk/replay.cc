@@ -0,0 +1,161 @@
+#include "replay.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "os.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // AllocationStats
+    //------------------------------------------------------------------------------
+
+    AllocationStats& allocationStats() {
+        static AllocationStats stats;
+        return stats;
+    }
+
+    //------------------------------------------------------------------------------
+    // ReplayReport
+    //------------------------------------------------------------------------------
+
+    void ReplayReport::print(std::ostream &os) const {
+        os << "events:      " << events << std::endl;
+        os << "frames:      " << frames << std::endl;
+        os << "seconds:     " << seconds << std::endl;
+        os << "events/sec:  " << eventsPerSecond() << std::endl;
+        os << "allocations: " << allocations << " (" << allocated_bytes << " bytes)" << std::endl;
+
+        os << std::left  << std::setw(10) << "phase"
+           << std::right
+           << std::setw(10) << "count"
+           << std::setw(12) << "mean_us"
+           << std::setw(12) << "p50_us"
+           << std::setw(12) << "p99_us"
+           << std::setw(12) << "max_us"
+           << std::endl;
+
+        auto line = [&os](const char *name, const LatencyHistogram &h) {
+            os << std::left  << std::setw(10) << name
+               << std::right
+               << std::setw(10) << h.count
+               << std::setw(12) << h.mean() / 1000.0
+               << std::setw(12) << h.percentile(0.50) / 1000.0
+               << std::setw(12) << h.percentile(0.99) / 1000.0
+               << std::setw(12) << h.max / 1000.0
+               << std::endl;
+        };
+        line("dispatch", dispatch);
+        line("layout",   layout);
+        line("idle",     idle);
+        line("render",   render);
+    }
+
+    //------------------------------------------------------------------------------
+    // Replay
+    //------------------------------------------------------------------------------
+
+    using WallClock = std::chrono::steady_clock;
+
+    static Nanoseconds elapsed(WallClock::time_point t0) {
+        return (Nanoseconds) std::chrono::duration_cast<std::chrono::nanoseconds>(WallClock::now() - t0).count();
+    }
+
+    // installs a clock while in scope
+    struct ClockBinding {
+    public:
+        ClockBinding(Clock &c): _previous(&clock()) { clock(&c); }
+        ~ClockBinding() { clock(_previous); }
+    private:
+        Clock *_previous;
+    };
+    
+    // sets a start time on the app while in scope
+    struct StartTimeBinding {
+    public:
+        StartTimeBinding(Microseconds &start_time, Microseconds t): _start_time(start_time), _previous(start_time) { _start_time = t; }
+        ~StartTimeBinding() { _start_time = _previous; }
+    private:
+        Microseconds &_start_time;
+        Microseconds  _previous;
+    };
+
+    ReplayReport Replay::run(const Source &source) {
+        ReplayReport report;
+
+        event::EventRecord r;
+        if (!source(r))
+            return report;
+
+        ManualClock      manual(r.timestamp);
+        ClockBinding     binding(manual);
+        StartTimeBinding start_time(_app._start_time, manual.now()); // the recording's time base
+
+        auto first_timestamp = r.timestamp;
+        auto allocations     = allocationStats().count.load();
+        auto allocated_bytes = allocationStats().bytes.load();
+        auto start           = WallClock::now();
+
+        do {
+            if (r.timestamp) {
+                manual.set(std::max(manual.now(), r.timestamp));
+                if (_realtime && r.timestamp >= first_timestamp && _speed > 0.0) {
+                    auto offset = std::chrono::microseconds((long long) ((r.timestamp - first_timestamp) / _speed));
+                    std::this_thread::sleep_until(start + offset);
+                }
+            }
+            else {
+                manual.advance(_unstamped_step);
+            }
+
+            auto t0 = WallClock::now();
+            _app.processEvent(r);
+            if (r.type == event::EVENT_WINDOW_RESIZE)
+                report.layout.add(elapsed(t0));
+            else
+                report.dispatch.add(elapsed(t0));
+            ++report.events;
+
+            t0 = WallClock::now();
+            _app.idle();
+            report.idle.add(elapsed(t0));
+
+            if (_render && _app.window() && _app.needsRender()) {
+                t0 = WallClock::now();
+                _app.renderFrame(*_app.window());
+                report.render.add(elapsed(t0));
+                ++report.frames;
+            }
+            else {
+                _app.skipFrame();
+            }
+        } while (source(r));
+
+        report.seconds         = std::chrono::duration<double>(WallClock::now() - start).count();
+        report.allocations     = allocationStats().count.load() - allocations;
+        report.allocated_bytes = allocationStats().bytes.load() - allocated_bytes;
+        return report;
+    }
+
+    ReplayReport Replay::run(std::istream &text) {
+        return run([&text](event::EventRecord &r) {
+            if ((text >> std::ws).peek() == std::char_traits<char>::eof())
+                return false;
+            if (!event::readEvent(text, r))
+                throw std::runtime_error("unknown event type in text event log");
+            return true;
+        });
+    }
+
+    ReplayReport Replay::run(event::BinaryLogReader &reader) {
+        return run([&reader](event::EventRecord &r) {
+            return reader.next(r);
+        });
+    }
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iosfwd>
+#include <new>
+
+#include "app.hh"
+#include "clock.hh"
+#include "event_log.hh"
+#include "profile.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // AllocationStats
+    //------------------------------------------------------------------------------
+
+    /*! \brief heap allocations counted by LLUITK_COUNT_ALLOCATIONS
+     *
+     * Counts stay at zero unless the executable expands
+     * LLUITK_COUNT_ALLOCATIONS once at global scope, replacing the global
+     * operator new/delete with counting versions.
+     */
+    struct AllocationStats {
+    public:
+        std::atomic<std::uint64_t> count { 0 };
+        std::atomic<std::uint64_t> bytes { 0 };
+    };
+
+    AllocationStats& allocationStats();
+
+#define LLUITK_COUNT_ALLOCATIONS                                                        \
+    void* operator new(std::size_t n) {                                                 \
+        auto &stats = ::lluitk::allocationStats();                                      \
+        stats.count.fetch_add(1, std::memory_order_relaxed);                            \
+        stats.bytes.fetch_add(n, std::memory_order_relaxed);                            \
+        if (auto p = std::malloc(n ? n : 1))                                            \
+            return p;                                                                   \
+        throw std::bad_alloc();                                                         \
+    }                                                                                   \
+    void* operator new[](std::size_t n) { return ::operator new(n); }                   \
+    void  operator delete(void *p) noexcept { std::free(p); }                           \
+    void  operator delete[](void *p) noexcept { std::free(p); }
+
+    //------------------------------------------------------------------------------
+    // ReplayReport
+    //------------------------------------------------------------------------------
+
+    struct ReplayReport {
+    public:
+        double eventsPerSecond() const { return seconds > 0.0 ? events / seconds : 0.0; }
+
+        // one line per phase: count mean p50 p99 max (in us)
+        void print(std::ostream &os) const;
+
+    public:
+        std::size_t      events          { 0 };
+        std::size_t      frames          { 0 };
+        double           seconds         { 0.0 }; // wall time of the whole replay
+
+        // wall time per call, in nanoseconds
+        LatencyHistogram dispatch;  // processEvent of input events
+        LatencyHistogram layout;    // processEvent of window resizes
+        LatencyHistogram idle;      // timers and posted work
+        LatencyHistogram render;    // renderFrame
+
+        // include the ones made to read the source (none for a binary log)
+        std::uint64_t    allocations     { 0 };
+        std::uint64_t    allocated_bytes { 0 };
+    };
+
+    //------------------------------------------------------------------------------
+    // Replay
+    //------------------------------------------------------------------------------
+
+    /*! \brief feeds a recorded event stream into an App
+     *
+     * While replaying, a ManualClock following the recorded timestamps is
+     * installed as the toolkit clock, so everything time dependent in the
+     * widgets (double clicks, wheel acceleration, timers) sees the original
+     * timing and the run is deterministic. Unstamped events advance the clock
+     * by a fixed step.
+     *
+     * Events go through App::processEvent, then the app's due timers and
+     * posted work run, then a frame is rendered if the tree needs it and the
+     * app has a window. Events are replayed as fast as possible unless
+     * realtime is on, in which case the original pacing is reproduced
+     * (scaled by speed).
+     */
+    struct Replay {
+    public:
+        using Source = std::function<bool(event::EventRecord&)>;
+
+    public:
+        Replay(App &app): _app(app) {}
+
+        Replay& realtime(bool flag, double speed=1.0) { _realtime = flag; _speed = speed; return *this; }
+        Replay& render(bool flag) { _render = flag; return *this; }
+        Replay& unstampedStep(Microseconds dt) { _unstamped_step = dt; return *this; }
+
+        ReplayReport run(const Source &source);
+        ReplayReport run(std::istream &text); // event::writeEvent format; throws on an event it can't read
+        ReplayReport run(event::BinaryLogReader &reader);
+
+    private:
+        App          &_app;
+        bool          _realtime { false };
+        double        _speed { 1.0 };
+        bool          _render { true };
+        Microseconds  _unstamped_step { 16667 }; // one 60Hz frame
+    };
+
+}
@@ -1,5 +1,7 @@
 #include "simple_widget.hh"
 
+#include "tree_stats.hh"
+
 namespace lluitk {
     
     //------------------------------------------------------------------------------
@@ -11,13 +13,26 @@ namespace lluitk {
     }
     
     void SimpleWidget::parent(Widget* parent) {
+        if (_parent == parent)
+            return;
         _parent = parent;
+        invalidateStyle();
+    }
+    
+    void SimpleWidget::memoryUsage(MemoryUsage &usage) const {
+        Widget::memoryUsage(usage);
+        usage.object = sizeof(SimpleWidget);
+        if (_style)
+            usage.style += sizeof(WidgetStyle);
+        if (_style_cache)
+            usage.style += sizeof(StyleCache);
     }
     
     WidgetStyle& SimpleWidget::style() {
         if (!_style) {
             _style.reset(new WidgetStyle());
         }
+        invalidateStyle();
         return *_style.get();
     }
     
@@ -27,6 +42,7 @@ namespace lluitk {
         }
         auto &s = *_style.get();
         s = style;
+        invalidateStyle();
         return *this;
     }
     
@@ -38,19 +54,46 @@ namespace lluitk {
         return _style.get() != nullptr;
     }
     
-    WidgetStyle SimpleWidget::inheritedStyle() const {
-        auto result = WidgetStyle::defaultStyle();
-        auto w = this;
-        while (w) {
-            if (w->styleFlag())
-                result = result + w->style();
-            auto p = w->parent();
-            if (p)
-                w = p->as<SimpleWidget>();
-            else
-                w = nullptr;
+    const WidgetStyle& SimpleWidget::resolvedStyle() const {
+        if (_style_valid)
+            return _style_cache->resolved;
+        
+        static const WidgetStyle defaults = WidgetStyle::defaultStyle();
+        
+        if (!_style_cache) {
+            _style_cache.reset(new StyleCache());
         }
-        return result;
+        auto &cache = *_style_cache.get();
+        
+        cache.chain = styleFlag() ? style() : WidgetStyle();
+        auto p = _parent ? _parent->as<SimpleWidget>() : nullptr;
+        if (p) {
+            p->resolvedStyle();
+            cache.chain = cache.chain + p->_style_cache->chain;
+        }
+        cache.resolved = defaults + cache.chain;
+        
+        _style_valid = true;
+        return cache.resolved;
+    }
+    
+    void SimpleWidget::invalidateStyle() {
+        //
+        // a valid cache below implies a valid cache here (resolving a
+        // widget resolves its ancestors first), so the walk stops at
+        // widgets that are already invalid
+        //
+        if (!_style_valid)
+            return;
+        WidgetWalker walker;
+        walker.walk(this, [](Widget *w) {
+            auto s = w->as<SimpleWidget>();
+            if (!s || !s->_style_valid)
+                return WALK_SKIP;
+            s->_style_valid = false;
+            s->onStyleChanged();
+            return WALK_CONTINUE;
+        });
     }
 
-}
\ No newline at end of file
+}
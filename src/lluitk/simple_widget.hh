@@ -12,21 +12,53 @@ namespace  lluitk {
     //------------------------------------------------------------------------------
     
     struct SimpleWidget: public Widget {
+    public:
+        LLUITK_WIDGET_KIND(SimpleWidget, WIDGET_SIMPLE)
+        
+        SimpleWidget() { _kinds |= widget_kind; }
+        
     public: // on event methods (should be overriden by subclasses)
         
         virtual Widget*        parent() const;
         virtual void           parent(Widget* parent);
         
+        void                   memoryUsage(MemoryUsage &usage) const;
+        
+        // the non-const accessor assumes the style is about to change and
+        // drops the resolved styles below this widget (call invalidateStyle()
+        // when changing it later through a kept reference)
         WidgetStyle&           style();
         const WidgetStyle&     style() const;
         SimpleWidget&          style(const WidgetStyle& s);
         bool                   styleFlag() const;
 
-        WidgetStyle            inheritedStyle() const;
+        WidgetStyle            inheritedStyle() const { return resolvedStyle(); }
+        
+        //
+        // default style merged with the styles of this widget and of its
+        // SimpleWidget ancestors. Cached: it is only merged again after a
+        // style or parent change on the way to the root.
+        //
+        const WidgetStyle&     resolvedStyle() const;
+        
+        // drops the cached resolved style of this widget and of the
+        // descendants (through children()) that inherited it
+        void                   invalidateStyle();
+        
+        // the resolved style changed (after having been resolved)
+        virtual void           onStyleChanged() {}
     
     protected:
-        Widget*                      _parent { nullptr };
-        std::unique_ptr<WidgetStyle> _style;
+        struct StyleCache {
+            WidgetStyle chain;    // own style merged with the ancestors' (no defaults)
+            WidgetStyle resolved; // defaults + chain
+        };
+        
+    protected:
+        Widget*                             _parent { nullptr };
+        std::unique_ptr<WidgetStyle>        _style;
+        mutable std::unique_ptr<StyleCache> _style_cache;
+        mutable bool                        _style_valid { false };
     };
 
 }
\ No newline at end of file
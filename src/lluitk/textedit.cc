@@ -1,12 +1,15 @@
 #include "textedit.hh"
 
 #include <algorithm>
+#include <cmath>
 
 #include "llsg/llsg_opengl.hh"
 #include "llsg/transition.hh"
 
 #include "d3cpp.hh"
 #include "app.hh"
+#include "render_batch.hh"
+#include "tree_stats.hh"
 
 #include "os.hh"
 
@@ -28,16 +31,21 @@ namespace lluitk {
     }
 
     void TextEdit::render() {
-        if (_canvas.dirty) {
+        if (_canvas.dirty || _cursor_dirty) {
             prepareCanvas();
         }
         
         if (_window.width() <= 0.0 || _window.height() <= 0.0) return;
         
-        auto &renderer = llsg::opengl::getRenderer();
-        
         // llsg::print(std::cerr, canvas.root);
-        renderer.render(_canvas.root, llsg::Transform(), _window);
+        submitRender(_canvas.root, llsg::Transform(), _window, true, &_display_list);
+    }
+    
+    void TextEdit::memoryUsage(MemoryUsage &usage) const {
+        SimpleWidget::memoryUsage(usage);
+        usage.object = sizeof(TextEdit);
+        usage.text  += _text.capacity();
+        usage.addScene(_canvas.root, usage.scene);
     }
     
     void TextEdit::prepareCanvas() {
@@ -46,9 +54,11 @@ namespace lluitk {
         
         document_type document(&_canvas.root);
         
+        _display_list.invalidate();
+        
         _canvas.root.identity().translate(_window.min());
         
-        auto style = inheritedStyle();
+        auto &style = resolvedStyle();
 
         // default font etc
         _canvas.root.style().typeface().reset(style.typeface()());
@@ -105,6 +115,8 @@ namespace lluitk {
             auto sel = document
             .selectAll(llsg::isPath, llsg::iter(1,1))
             .data( _is_focused ? std::vector<double> { bbox.max().x() + 1 } : std::vector<double> {});
+            
+            _cursor_x = bbox.max().x() + 1;
 
             sel
             .exit()
@@ -126,12 +138,22 @@ namespace lluitk {
         }
         
         _canvas.markDirty(false);
+        _cursor_dirty = false;
         
     }
     
+    Window TextEdit::cursorWindow() const {
+        auto x = _window.x() + _offset.x() + _cursor_x;
+        return Window(Vec2(std::floor(x) - 2, _window.y()), Vec2(std::ceil(x) + 2, _window.Y()));
+    }
+    
     void TextEdit::blink(int parity) {
         _parity = parity;
-        _canvas.markDirty();
+        if (!_is_focused)
+            return; // no cursor to draw
+        // only the cursor changes color: redraw just its column
+        _cursor_dirty = true;
+        invalidate(cursorWindow());
     }
 
     const Vec2& TextEdit::offset() const {
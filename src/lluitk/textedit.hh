@@ -5,6 +5,7 @@
 #include "llsg/llsg.hh"
 #include "simple_widget.hh"
 #include "canvas.hh"
+#include "render_batch.hh"
 
 namespace lluitk {
 
@@ -31,17 +32,23 @@ namespace lluitk {
         using TriggerFunction = std::function<void(const std::string&)>;
         
     public:
-        TextEdit() = default;
+        LLUITK_WIDGET_KIND(TextEdit, WIDGET_TEXTEDIT)
+        
+        TextEdit() { _kinds |= widget_kind | WIDGET_KEY_EVENTS | WIDGET_LAYOUT_THREAD_SAFE | WIDGET_RENDER_ON_DEMAND; }
         void render(); // assuming opengl context in pixel
+        bool needsRender() const { return _canvas.dirty; }
+        void memoryUsage(MemoryUsage &usage) const;
+        void onStyleChanged() { _canvas.markDirty(true); }
     private:
         void prepareCanvas();
+        Window cursorWindow() const; // column of the cursor (window coordinates)
     public:
         bool contains(const Point& p) const;
+        bool bounds(Window &w) const { w = _window; return true; }
         void sizeHint(const Window &window);
         void onKeyPress(const App &app);
         void onMouseMove(const App &app);
         
-        bool acceptsKeyEvents() const { return true; }
         void setKeyFocus(bool focused);
 
 
@@ -59,10 +66,13 @@ namespace lluitk {
         std::size_t       _cursor { 0 };
         Window            _window;
         Canvas            _canvas;
+        DisplayList       _display_list;             // of _canvas
         int               _parity { 0 };
         TriggerFunction   _trigger;
         llsg::Vec2        _offset { 5, 5 };
         bool              _is_focused { false };
+        double            _cursor_x { 0.0 };         // relative to _offset, as last drawn
+        bool              _cursor_dirty { false };   // only the cursor color changed
     };
 
 }
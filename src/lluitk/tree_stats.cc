@@ -0,0 +1,232 @@
+#include "tree_stats.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <typeinfo>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // MemoryUsage
+    //------------------------------------------------------------------------------
+
+    MemoryUsage& MemoryUsage::operator+=(const MemoryUsage &u) {
+        object   += u.object;
+        style    += u.style;
+        scene    += u.scene;
+        geometry += u.geometry;
+        text     += u.text;
+        nodes    += u.nodes;
+        other    += u.other;
+        elements += u.elements;
+        return *this;
+    }
+
+    static std::size_t elementSize(llsg::Element *e) {
+        if (llsg::isGroup(e))
+            return sizeof(llsg::Group);
+        else if (llsg::isRect(e))
+            return sizeof(llsg::Rectangle);
+        else if (llsg::isText(e))
+            return sizeof(llsg::Text);
+        else if (llsg::isPath(e))
+            return sizeof(llsg::Path);
+        else
+            return sizeof(llsg::Element);
+    }
+
+    static void addElements(llsg::Element *e, std::size_t &bytes, std::size_t &elements) {
+        llsg::ElementIterator it(e, 1, 1);
+        while (auto child = it.next()) {
+            bytes += elementSize(child);
+            ++elements;
+            addElements(child, bytes, elements);
+        }
+    }
+
+    void MemoryUsage::addScene(const llsg::Element &root, std::size_t &bytes) {
+        ++elements;
+        addElements(const_cast<llsg::Element*>(&root), bytes, elements);
+    }
+
+    //------------------------------------------------------------------------------
+    // TreeStats
+    //------------------------------------------------------------------------------
+
+    static std::string typeName(const Widget &w) {
+        auto name = typeid(w).name();
+#if defined(__GNUG__)
+        int status = 0;
+        if (auto demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status)) {
+            std::string result(demangled);
+            std::free(demangled);
+            return result;
+        }
+#endif
+        return name;
+    }
+
+    TreeStats& TreeStats::collect(const Widget *root) {
+        *this = TreeStats();
+        if (!root)
+            return *this;
+
+        std::vector<std::size_t> open; // path from the root to the current widget
+        WidgetWalker walker;
+        walker.walk(const_cast<Widget*>(root),
+                    [this, &open](Widget *w) {
+                        WidgetStats s;
+                        s.widget = w;
+                        s.type   = typeName(*w);
+                        s.depth  = open.size();
+                        s.parent = open.empty() ? 0 : open.back();
+                        w->memoryUsage(s.usage);
+                        if (!open.empty())
+                            ++widgets[open.back()].children;
+                        open.push_back(widgets.size());
+                        widgets.push_back(std::move(s));
+                        return WALK_CONTINUE;
+                    },
+                    [this, &open](Widget *w) {
+                        widgets[open.back()].subtree = widgets.size() - open.back();
+                        open.pop_back();
+                    });
+
+        std::map<std::string, TypeStats> by_type;
+        for (auto &s: widgets) {
+            total += s.usage;
+            max_depth  = std::max(max_depth, s.depth);
+            max_fanout = std::max(max_fanout, s.children);
+            if (s.children == 0)
+                ++leaves;
+            auto &t = by_type[s.type];
+            t.type = s.type;
+            ++t.instances;
+            t.usage += s.usage;
+        }
+        for (auto &it: by_type)
+            types.push_back(std::move(it.second));
+        std::stable_sort(types.begin(), types.end(), [](const TypeStats &a, const TypeStats &b) {
+            return a.usage.total() > b.usage.total();
+        });
+        return *this;
+    }
+
+    double TreeStats::meanFanout() const {
+        auto containers = widgets.size() - leaves;
+        return containers ? (double) (widgets.size() - 1) / containers : 0.0;
+    }
+
+    static void jsonString(std::ostream &os, const std::string &s) {
+        os << '"';
+        for (auto c: s) {
+            if (c == '"' || c == '\\')
+                os << '\\';
+            os << c;
+        }
+        os << '"';
+    }
+
+    static void jsonUsage(std::ostream &os, const MemoryUsage &u) {
+        os << "\"bytes\": "    << u.total()
+           << ", \"object\": "   << u.object
+           << ", \"style\": "    << u.style
+           << ", \"scene\": "    << u.scene
+           << ", \"geometry\": " << u.geometry
+           << ", \"text\": "     << u.text
+           << ", \"nodes\": "    << u.nodes
+           << ", \"other\": "    << u.other
+           << ", \"elements\": " << u.elements;
+    }
+
+    void TreeStats::json(std::ostream &os) const {
+        os << "{" << std::endl;
+        os << "  \"widgets\": "     << widgets.size() << "," << std::endl;
+        os << "  \"leaves\": "      << leaves << "," << std::endl;
+        os << "  \"max_depth\": "   << max_depth << "," << std::endl;
+        os << "  \"max_fanout\": "  << max_fanout << "," << std::endl;
+        os << "  \"mean_fanout\": " << meanFanout() << "," << std::endl;
+        os << "  \"total\": { ";
+        jsonUsage(os, total);
+        os << " }," << std::endl;
+
+        os << "  \"types\": [" << std::endl;
+        for (std::size_t i=0;i<types.size();++i) {
+            auto &t = types[i];
+            os << "    { \"type\": ";
+            jsonString(os, t.type);
+            os << ", \"instances\": " << t.instances << ", ";
+            jsonUsage(os, t.usage);
+            os << " }" << (i + 1 < types.size() ? "," : "") << std::endl;
+        }
+        os << "  ]," << std::endl;
+
+        os << "  \"instances\": [" << std::endl;
+        for (std::size_t i=0;i<widgets.size();++i) {
+            auto &s = widgets[i];
+            os << "    { \"index\": " << i << ", \"type\": ";
+            jsonString(os, s.type);
+            os << ", \"parent\": "   << s.parent
+               << ", \"depth\": "    << s.depth
+               << ", \"children\": " << s.children
+               << ", \"subtree\": "  << s.subtree << ", ";
+            jsonUsage(os, s.usage);
+            os << " }" << (i + 1 < widgets.size() ? "," : "") << std::endl;
+        }
+        os << "  ]" << std::endl;
+        os << "}" << std::endl;
+    }
+
+    static void csvString(std::ostream &os, const std::string &s) {
+        os << '"';
+        for (auto c: s) {
+            if (c == '"')
+                os << '"';
+            os << c;
+        }
+        os << '"';
+    }
+
+    static void csvUsage(std::ostream &os, const MemoryUsage &u) {
+        os << u.total()    << ","
+           << u.object     << ","
+           << u.style      << ","
+           << u.scene      << ","
+           << u.geometry   << ","
+           << u.text       << ","
+           << u.nodes      << ","
+           << u.other      << ","
+           << u.elements;
+    }
+
+    void TreeStats::csv(std::ostream &os, bool per_type) const {
+        static const char *usage_columns = "bytes,object,style,scene,geometry,text,nodes,other,elements";
+        if (per_type) {
+            os << "type,instances," << usage_columns << std::endl;
+            for (auto &t: types) {
+                csvString(os, t.type); // type names may have commas
+                os << "," << t.instances << ",";
+                csvUsage(os, t.usage);
+                os << std::endl;
+            }
+        }
+        else {
+            os << "index,type,parent,depth,children,subtree," << usage_columns << std::endl;
+            for (std::size_t i=0;i<widgets.size();++i) {
+                auto &s = widgets[i];
+                os << i << ",";
+                csvString(os, s.type);
+                os << "," << s.parent << "," << s.depth << "," << s.children << "," << s.subtree << ",";
+                csvUsage(os, s.usage);
+                os << std::endl;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "widget.hh"
+
+#include "llsg/llsg.hh"
+
+namespace lluitk {
+
+    //------------------------------------------------------------------------------
+    // MemoryUsage
+    //------------------------------------------------------------------------------
+
+    /*! \brief bytes owned by a widget, by what holds them
+     *
+     * Filled by Widget::memoryUsage. Each class adds what it owns to what
+     * its base class reported and sets object to its own sizeof; a subclass
+     * that doesn't override memoryUsage is reported with the object size of
+     * the closest class that does.
+     *
+     * llsg scenes are estimated from the sizeof of each element's type (the
+     * heap blocks llsg keeps inside an element, e.g. path points, are not
+     * visible from here); the element counts are exact.
+     */
+    struct MemoryUsage {
+    public:
+        std::size_t total() const { return object + style + scene + geometry + text + nodes + other; }
+
+        MemoryUsage& operator+=(const MemoryUsage &u);
+
+        // adds the elements below root to bytes (root itself is part of
+        // its owner) and all of them, root included, to elements
+        void addScene(const llsg::Element &root, std::size_t &bytes);
+
+    public:
+        std::size_t object   { 0 }; // the widget itself
+        std::size_t style    { 0 }; // style blocks and resolved style caches
+        std::size_t scene    { 0 }; // llsg scenes: Canvas, hit test and scroller groups
+        std::size_t geometry { 0 }; // generated item geometry (List)
+        std::size_t text     { 0 }; // text buffers
+        std::size_t nodes    { 0 }; // container structure: Grid cells, Grid2 slots and divisions
+        std::size_t other    { 0 }; // layout and splitter vectors
+        std::size_t elements { 0 }; // llsg elements in the scenes
+    };
+
+    //------------------------------------------------------------------------------
+    // WidgetStats
+    //------------------------------------------------------------------------------
+
+    // one widget of the tree
+    struct WidgetStats {
+    public:
+        const Widget* widget   { nullptr };
+        std::string   type;                 // demangled class name
+        std::size_t   parent   { 0 };       // index in TreeStats::widgets (the root is its own parent)
+        std::size_t   depth    { 0 };       // root: 0
+        std::size_t   children { 0 };       // fan-out
+        std::size_t   subtree  { 1 };       // widgets in the subtree, itself included
+        MemoryUsage   usage;
+    };
+
+    //------------------------------------------------------------------------------
+    // TypeStats
+    //------------------------------------------------------------------------------
+
+    // all widgets of one class
+    struct TypeStats {
+    public:
+        std::string type;
+        std::size_t instances { 0 };
+        MemoryUsage usage;
+    };
+
+    //------------------------------------------------------------------------------
+    // TreeStats
+    //------------------------------------------------------------------------------
+
+    /*! \brief memory and shape of a widget tree
+     *
+     * collect() walks the tree through children() (containers that render
+     * their children themselves are still descended into) and asks every
+     * widget for its memoryUsage. Widgets are listed in pre-order, types by
+     * total bytes, largest first.
+     *
+     * json() writes everything; csv() writes one row per widget, or one
+     * row per type. Both formats are stable across releases so dumps can
+     * be diffed to track memory regressions.
+     */
+    struct TreeStats {
+    public:
+        TreeStats() = default;
+        TreeStats(const Widget *root) { collect(root); }
+
+        TreeStats& collect(const Widget *root);
+
+        void json(std::ostream &os) const;
+        void csv(std::ostream &os, bool per_type=false) const;
+
+        double meanFanout() const; // over the widgets with children
+
+    public:
+        std::vector<WidgetStats> widgets;
+        std::vector<TypeStats>   types;
+        MemoryUsage              total;
+        std::size_t              max_depth  { 0 };
+        std::size_t              max_fanout { 0 };
+        std::size_t              leaves     { 0 };
+    };
+
+}
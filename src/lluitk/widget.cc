@@ -1,5 +1,9 @@
 #include "widget.hh"
 
+#include <algorithm>
+
+#include "tree_stats.hh"
+
 namespace lluitk {
     
     //------------------------------------------------------------------------------
@@ -17,19 +21,162 @@ namespace lluitk {
         auto result = stack.back();
         stack.pop_back();
         
-        auto iter = result->children();
-        
-        std::vector<Widget*> children;
+        // push the children and flip them in place, so the first child is
+        // on top of the stack
+        auto first = stack.size();
+        auto iter  = result->children();
         Widget* child;
         while ((child = iter.next())) {
-            children.push_back(child);
-        }
-        
-        for (auto it=children.rbegin();it!=children.rend();++it) {
-            stack.push_back(*it);
+            stack.push_back(child);
         }
+        std::reverse(stack.begin() + first, stack.end());
 
         return result;
     }
 
-}
+    //------------------------------------------------------------------------------
+    // Widget
+    //------------------------------------------------------------------------------
+    
+    void Widget::invalidate(const Window &rect) {
+        auto p = parent();
+        if (p)
+            p->invalidate(rect);
+        else
+            notifyDamage(this, rect);
+    }
+    
+    void Widget::memoryUsage(MemoryUsage &usage) const {
+        usage.object = sizeof(Widget);
+    }
+    
+    static bool same(const Window &a, const Window &b) {
+        return a.x() == b.x() && a.y() == b.y() && a.X() == b.X() && a.Y() == b.Y();
+    }
+    
+    const Measure& Widget::measured(const Size &available) {
+        if (!_measure_valid || _measure_available.x() != available.x() || _measure_available.y() != available.y()) {
+            _measure           = measure(available);
+            _measure_available = available;
+            _measure_valid     = true;
+        }
+        return _measure;
+    }
+    
+    bool Widget::needsArrange(const Window &window) const {
+        return !_arranged_valid || !same(_arranged, window);
+    }
+    
+    bool Widget::arrange(const Window &window) {
+        if (!needsArrange(window))
+            return false;
+        _arranged       = window;
+        _arranged_valid = true; // before sizeHint: it may invalidate again
+        sizeHint(window);
+        return true;
+    }
+    
+    void Widget::invalidateLayout() {
+        // the whole path: an ancestor may be valid even if this widget
+        // isn't (e.g. it was never arranged)
+        for (auto w = this; w; w = w->parent()) {
+            w->_arranged_valid    = false;
+            w->_measure_valid     = false;
+            w->_layout_cost_valid = false;
+        }
+    }
+    
+    std::size_t Widget::layoutCost() {
+        if (_layout_cost_valid)
+            return _layout_cost;
+        std::size_t cost = 0;
+        if (is(WIDGET_LAYOUT_THREAD_SAFE)) {
+            cost = 1;
+            auto it = children();
+            while (auto child = it.next()) {
+                auto c = child->layoutCost();
+                if (!c) {
+                    cost = 0;
+                    break;
+                }
+                cost += c;
+            }
+        }
+        _layout_cost       = cost;
+        _layout_cost_valid = true;
+        return cost;
+    }
+    
+    //------------------------------------------------------------------------------
+    // LayoutObserver
+    //------------------------------------------------------------------------------
+    
+    static std::vector<LayoutObserver*>& layout_observers() {
+        static std::vector<LayoutObserver*> observers;
+        return observers;
+    }
+    
+    void addLayoutObserver(LayoutObserver *observer) {
+        layout_observers().push_back(observer);
+    }
+    
+    void removeLayoutObserver(LayoutObserver *observer) {
+        auto &observers = layout_observers();
+        observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+    }
+    
+    static const Widget* treeRoot(const Widget *widget) {
+        while (auto p = widget->parent())
+            widget = p;
+        return widget;
+    }
+    
+    std::size_t layoutVersion(const Widget *widget) {
+        return widget ? treeRoot(widget)->_tree_layout_version : 0;
+    }
+    
+    static thread_local std::vector<Widget*>* _deferred_layout_notifications = nullptr;
+    
+    std::vector<Widget*>* deferLayoutNotifications(std::vector<Widget*> *buffer) {
+        auto previous = _deferred_layout_notifications;
+        _deferred_layout_notifications = buffer;
+        return previous;
+    }
+    
+    void notifyLayoutChanged(Widget *widget) {
+        if (_deferred_layout_notifications) {
+            _deferred_layout_notifications->push_back(widget);
+            return;
+        }
+        if (widget)
+            ++const_cast<Widget*>(treeRoot(widget))->_tree_layout_version;
+        for (auto observer: layout_observers()) {
+            observer->layoutChanged(widget);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // DamageObserver
+    //------------------------------------------------------------------------------
+    
+    static std::vector<DamageObserver*>& damage_observers() {
+        static std::vector<DamageObserver*> observers;
+        return observers;
+    }
+    
+    void addDamageObserver(DamageObserver *observer) {
+        damage_observers().push_back(observer);
+    }
+    
+    void removeDamageObserver(DamageObserver *observer) {
+        auto &observers = damage_observers();
+        observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+    }
+    
+    void notifyDamage(Widget *root, const Window &rect) {
+        for (auto observer: damage_observers()) {
+            observer->damaged(root, rect);
+        }
+    }
+
+}
\ No newline at end of file
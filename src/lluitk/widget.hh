@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "geom.hh"
@@ -12,6 +17,7 @@ namespace lluitk {
     //------------------------------------------------------------------------------
     
     struct App;
+    struct MemoryUsage;
     struct Widget;
 
     //------------------------------------------------------------------------------
@@ -27,21 +33,152 @@ namespace lluitk {
     // WidgetIterator
     //------------------------------------------------------------------------------
     
+    //
+    // Owns a BaseWidgetIterator. Iterators built with make<T>() live in an
+    // inline buffer (no heap allocation) when they fit, which is the case
+    // for the toolkit containers; children() is called on every render and
+    // at every level of event routing.
+    //
+    // Wrapping a heap allocated iterator (WidgetIterator(new MyIterator(...)))
+    // is still supported for existing custom widgets.
+    //
     struct WidgetIterator {
+    public:
+        static const std::size_t INLINE_CAPACITY = 6 * sizeof(void*);
+        
+        template <typename T, typename... Args>
+        static WidgetIterator make(Args&&... args);
+        
     public:
         WidgetIterator() = default;
         
         WidgetIterator(const WidgetIterator& w) = delete;
         WidgetIterator& operator=(const WidgetIterator& w) = delete;
 
-        WidgetIterator(WidgetIterator&& other) { std::swap(_iter,other._iter); }
-        WidgetIterator& operator=(WidgetIterator&& other)  { std::swap(_iter,other._iter); return *this; }
+        WidgetIterator(WidgetIterator&& other) { take(other); }
+        WidgetIterator& operator=(WidgetIterator&& other) { if (this != &other) { reset(); take(other); } return *this; }
 
-        WidgetIterator(BaseWidgetIterator *it): _iter(it) {}
-        ~WidgetIterator() { delete _iter; };
+        WidgetIterator(BaseWidgetIterator *it): _iter(it) {} // takes ownership of a heap allocated iterator
+        ~WidgetIterator() { reset(); };
         Widget* next() { return (_iter) ? _iter->next() : nullptr; }
+        
+        bool inlined() const { return _relocate != nullptr; }
+
+    private:
+        // moves the iterator at from into to (only destroys it if to is null)
+        using Relocate = BaseWidgetIterator* (*)(BaseWidgetIterator *from, void *to);
+
+        template <typename T>
+        static BaseWidgetIterator* relocate(BaseWidgetIterator *from, void *to);
+
+        void reset();
+        void take(WidgetIterator &other);
+        
     public:
         BaseWidgetIterator *_iter { nullptr };
+    private:
+        Relocate _relocate { nullptr };
+        typename std::aligned_storage<INLINE_CAPACITY, alignof(std::max_align_t)>::type _storage;
+    };
+    
+    template <typename T, typename... Args>
+    WidgetIterator WidgetIterator::make(Args&&... args) {
+        WidgetIterator result;
+        if (sizeof(T) <= INLINE_CAPACITY && alignof(T) <= alignof(std::max_align_t)) {
+            result._iter     = new (&result._storage) T(std::forward<Args>(args)...);
+            result._relocate = &relocate<T>;
+        }
+        else {
+            result._iter     = new T(std::forward<Args>(args)...);
+        }
+        return result;
+    }
+    
+    template <typename T>
+    BaseWidgetIterator* WidgetIterator::relocate(BaseWidgetIterator *from, void *to) {
+        auto it = static_cast<T*>(from);
+        BaseWidgetIterator *result = nullptr;
+        if (to)
+            result = new (to) T(std::move(*it));
+        it->~T();
+        return result;
+    }
+    
+    inline void WidgetIterator::reset() {
+        if (_relocate)
+            _relocate(_iter, nullptr);
+        else
+            delete _iter;
+        _iter     = nullptr;
+        _relocate = nullptr;
+    }
+    
+    inline void WidgetIterator::take(WidgetIterator &other) {
+        if (other._relocate) {
+            _iter     = other._relocate(other._iter, &_storage);
+            _relocate = other._relocate;
+        }
+        else {
+            _iter     = other._iter;
+        }
+        other._iter     = nullptr;
+        other._relocate = nullptr;
+    }
+    
+    //------------------------------------------------------------------------------
+    // WidgetKind
+    //------------------------------------------------------------------------------
+    
+    //
+    // Bits of Widget::kinds(). Type bits are set by the constructor of the
+    // class and kept by its subclasses; capability bits are hints that
+    // subclasses may clear, so they never go in a LLUITK_WIDGET_KIND tag.
+    //
+    enum WidgetKind: std::uint32_t {
+        WIDGET_SIMPLE     = 0x1,
+        WIDGET_GRID       = 0x2,
+        WIDGET_GRID2      = 0x4,
+        WIDGET_TEXTEDIT   = 0x8,
+        WIDGET_LIST       = 0x10,
+        
+        WIDGET_CONTAINER  = 0x100, // has children
+        WIDGET_KEY_EVENTS = 0x200, // what the default acceptsKeyEvents() returns
+        WIDGET_LAYOUT_THREAD_SAFE = 0x400, // sizeHint only touches the widget's own state and
+                                           // arranges its children: sibling subtrees may be laid
+                                           // out in parallel (subclasses overriding sizeHint
+                                           // with shared state must clear this bit)
+        WIDGET_OPAQUE     = 0x800, // opaque() is true
+        WIDGET_RENDER_ON_DEMAND = 0x1000, // needsRender() is kept accurate; without it the
+                                          // default needsRender() has the widget drawn every frame
+        
+        WIDGET_USER       = 0x10000 // first bit free for application classes
+    };
+    
+    //
+    // Declares the kind (type bits only) of a widget class, which then also
+    // has to add it to _kinds in its constructors. as<Class>() becomes a
+    // bit test instead of a dynamic_cast; subclasses that don't declare
+    // their own kind keep using dynamic_cast.
+    //
+#define LLUITK_WIDGET_KIND(Class, kind)                          \
+    static constexpr std::uint32_t widget_kind = kind;          \
+    using widget_kind_class = Class;
+    
+    template <typename T, typename = void>
+    struct has_widget_kind: std::false_type {};
+    
+    template <typename T>
+    struct has_widget_kind<T, typename std::enable_if<std::is_same<typename T::widget_kind_class, T>::value>::type>: std::true_type {};
+    
+    //------------------------------------------------------------------------------
+    // Measure
+    //------------------------------------------------------------------------------
+    
+    // result of the measure pass
+    struct Measure {
+        Size minimum   { 0.0, 0.0 };
+        Size preferred { 0.0, 0.0 };
+        Size maximum   { 1.0e9, 1.0e9 }; // unbounded
     };
     
     //------------------------------------------------------------------------------
@@ -53,6 +190,10 @@ namespace lluitk {
         
         virtual bool           contains(const Point& p) const { return false; }
         
+        // current window of the widget (if it keeps track of one). The
+        // window is expected to enclose every point where contains is true
+        virtual bool           bounds(Window &window) const { return false; }
+        
         // bottom-up (rendering order)
         virtual WidgetIterator children() const { return WidgetIterator(); }
         
@@ -64,13 +205,65 @@ namespace lluitk {
         
         template <typename T>
         T* as() {
-            return dynamic_cast<T*>(this);
+            return cast<T>(this, has_widget_kind<T>());
+        }
+        
+        template <typename T>
+        const T* as() const {
+            return const_cast<Widget*>(this)->as<T>();
         }
         
+        std::uint32_t  kinds() const { return _kinds; }
+        bool           is(std::uint32_t kinds) const { return (_kinds & kinds) == kinds; }
+        
+    protected:
+        std::uint32_t  _kinds { 0 }; // WidgetKind bits
+        
+    private:
+        template <typename T>
+        static T* cast(Widget *w, std::true_type)  { return w->is(T::widget_kind) ? static_cast<T*>(w) : nullptr; }
+        
+        template <typename T>
+        static T* cast(Widget *w, std::false_type) { return dynamic_cast<T*>(w); }
+        
     public: // on event methods (should be overriden by subclasses)
         
+        //
+        // App walks the tree and calls render() on each widget before its
+        // children and render_overlay() after them, so containers draw
+        // their own background in render() and what goes on top of the
+        // children (e.g. handles) in render_overlay(). pre_render() is
+        // called on the whole tree before rendering starts. Widgets App
+        // culls (see Culler) get neither call.
+        //
         virtual void render() {}
+        virtual void render_overlay() {}
         virtual void pre_render() {}
+        
+        // containers that still render their children themselves return
+        // true: App then doesn't descend into them (nor calls their overlay)
+        virtual bool rendersChildren() const { return false; }
+        
+        // render() paints every pixel of bounds() with full alpha, so
+        // whatever was drawn there before doesn't need to be
+        virtual bool opaque() const { return is(WIDGET_OPAQUE); }
+        
+        // true when the next render() would differ from the last one; App::run
+        // only draws a frame when some widget of the tree asks for it, and
+        // then redraws the whole bounds() of that widget. Widgets that
+        // override it set WIDGET_RENDER_ON_DEMAND; the others are drawn every
+        // frame. A handler that changes only part of the widget can call
+        // invalidate(rect) instead
+        virtual bool needsRender() const { return !is(WIDGET_RENDER_ON_DEMAND); }
+        
+        // adds the memory the widget owns to usage (see TreeStats);
+        // overrides call their base class first, then set usage.object
+        virtual void memoryUsage(MemoryUsage &usage) const;
+        
+        // asks for rect (window coordinates) to be drawn again in the next
+        // frame. Goes up the parent() chain; the root reports it to the
+        // damage observers (the App)
+        virtual void invalidate(const Window &rect);
 
         virtual void onMousePress(const App &app) {}
         virtual void onMouseRelease(const App &app) {}
@@ -84,7 +277,7 @@ namespace lluitk {
         virtual void onMouseMove(const App &app) {}
         virtual void onMouseWheel(const App &app) {}
 
-        virtual bool acceptsKeyEvents() const { return false; }
+        virtual bool acceptsKeyEvents() const { return is(WIDGET_KEY_EVENTS); }
         virtual void setKeyFocus(bool focused) { }
         
         virtual void blink(int parity) {};
@@ -93,6 +286,51 @@ namespace lluitk {
                                                                  // to redefine boundaries of the
                                                                  // children widget etc.
 
+    public: // layout
+        
+        //
+        // Two passes: measure (sizes a widget would like for an available
+        // size) and arrange (sizeHint with the final window). Containers
+        // arrange their children with arrange() instead of calling sizeHint
+        // directly, so a child whose window didn't change and whose layout
+        // is still valid is skipped. A widget whose size needs change (e.g.
+        // a list that grew) calls invalidateLayout(): the next arrange from
+        // the root (App does it before rendering) only goes down that path.
+        // Grid2 keeps each slot between the minimum and maximum its widget
+        // measures.
+        //
+        virtual Measure measure(const Size &available) { Measure m; m.preferred = available; return m; }
+        
+        // measure(available), cached until invalidateLayout or a different available size
+        const Measure& measured(const Size &available);
+        
+        // sizeHint(window) unless already arranged to window with a valid
+        // layout; true if sizeHint ran
+        bool arrange(const Window &window);
+        
+        void invalidateLayout();
+        bool layoutValid() const { return _arranged_valid; }
+        
+        // false if arrange(window) would return right away
+        bool needsArrange(const Window &window) const;
+        
+        // widgets of the subtree if all of them are WIDGET_LAYOUT_THREAD_SAFE,
+        // otherwise 0 (what parallel layout weighs siblings by). Cached until
+        // invalidateLayout() below it, which structural changes call
+        std::size_t layoutCost();
+        
+    private:
+        friend void        notifyLayoutChanged(Widget *widget);
+        friend std::size_t layoutVersion(const Widget *widget);
+        
+        Window        _arranged;
+        Size          _measure_available;
+        Measure       _measure;
+        std::size_t   _tree_layout_version { 0 }; // on the root: see layoutVersion()
+        std::size_t   _layout_cost { 0 };
+        bool          _arranged_valid { false };
+        bool          _measure_valid { false };
+        bool          _layout_cost_valid { false };
     };
 
     //----------------------------------------------------------------------------
@@ -105,6 +343,137 @@ namespace lluitk {
         std::vector<Widget*> stack;
     };
     
+    //----------------------------------------------------------------------------
+    // WidgetWalker
+    //----------------------------------------------------------------------------
+    
+    enum WalkAction {
+        WALK_CONTINUE, // visit the children of the widget
+        WALK_SKIP,     // prune: neither its children nor its post visit
+        WALK_STOP      // end the walk
+    };
+    
+    //
+    // Depth first traversal calling pre(widget) before the children of a
+    // widget and post(widget) after them. pre returns a WalkAction; post
+    // returns nothing. Children come in children() order, or in
+    // reverse_children() order when reverse is on.
+    //
+    // The frames of the walk (one per level, holding the inline child
+    // iterator) are kept in a vector that is reused across walks, so once
+    // it has grown to the depth of the tree a walk doesn't allocate.
+    // Visitors may start a nested walk with the same walker.
+    //
+    struct WidgetWalker {
+    public:
+        WidgetWalker(bool reverse=false): _reverse(reverse) {}
+        
+        WidgetWalker(const WidgetWalker& other) = delete;
+        WidgetWalker& operator=(const WidgetWalker& other) = delete;
+        
+        WidgetWalker(WidgetWalker&& other) = default;
+        WidgetWalker& operator=(WidgetWalker&& other) = default;
+        
+        WidgetWalker& reverse(bool flag) { _reverse = flag; return *this; }
+        bool          reverse() const { return _reverse; }
+        
+        // false if the walk was stopped
+        template <typename Pre, typename Post>
+        bool walk(Widget *root, Pre &&pre, Post &&post);
+        
+        template <typename Pre>
+        bool walk(Widget *root, Pre &&pre) { return walk(root, std::forward<Pre>(pre), [](Widget*) {}); }
+        
+    private:
+        struct Frame {
+            Widget*        widget;
+            WidgetIterator children;
+        };
+        
+        WidgetIterator children(Widget *w) const { return _reverse ? w->reverse_children() : w->children(); }
+        
+    private:
+        std::vector<Frame> _stack;
+        bool               _reverse { false };
+    };
+    
+    template <typename Pre, typename Post>
+    bool WidgetWalker::walk(Widget *root, Pre &&pre, Post &&post) {
+        if (!root)
+            return true;
+        
+        auto action = pre(root);
+        if (action != WALK_CONTINUE)
+            return action != WALK_STOP;
+        
+        auto base = _stack.size();
+        _stack.push_back(Frame { root, children(root) });
+        while (_stack.size() > base) {
+            auto child = _stack.back().children.next();
+            if (child) {
+                action = pre(child);
+                if (action == WALK_STOP) {
+                    _stack.erase(_stack.begin() + base, _stack.end());
+                    return false;
+                }
+                if (action == WALK_CONTINUE) {
+                    _stack.push_back(Frame { child, children(child) });
+                }
+            }
+            else {
+                auto w = _stack.back().widget;
+                _stack.pop_back();
+                post(w);
+            }
+        }
+        return true;
+    }
+    
+    //----------------------------------------------------------------------------
+    // LayoutObserver
+    //----------------------------------------------------------------------------
+    
+    //
+    // Containers call notifyLayoutChanged(this) once they have assigned new
+    // windows to their children (or changed which children they have), so
+    // that structures caching widget geometry (e.g. the App's hit index) can
+    // refresh the affected subtree only.
+    //
+    struct LayoutObserver {
+        virtual ~LayoutObserver() {}
+        virtual void layoutChanged(Widget *widget) = 0;
+    };
+    
+    void addLayoutObserver(LayoutObserver *observer);
+    void removeLayoutObserver(LayoutObserver *observer);
+    void notifyLayoutChanged(Widget *widget);
+    
+    // while buffer is set, notifyLayoutChanged on this thread appends the
+    // widget to it instead of notifying; returns the previous buffer
+    std::vector<Widget*>* deferLayoutNotifications(std::vector<Widget*> *buffer);
+    
+    //----------------------------------------------------------------------------
+    // DamageObserver
+    //----------------------------------------------------------------------------
+    
+    //
+    // Receives the invalidate() rectangles that reached the root of a tree
+    //
+    struct DamageObserver {
+        virtual ~DamageObserver() {}
+        virtual void damaged(Widget *root, const Window &rect) = 0;
+    };
+    
+    void addDamageObserver(DamageObserver *observer);
+    void removeDamageObserver(DamageObserver *observer);
+    void notifyDamage(Widget *root, const Window &rect);
+    
+    // version of the layout of widget's tree, kept on its root (the end of
+    // the parent() chain) and incremented on every notifyLayoutChanged
+    // inside that tree: cached geometry taken at an older version might be
+    // stale. Layout changes in other trees (other windows) don't touch it
+    std::size_t layoutVersion(const Widget *widget);
+    
 
 
     